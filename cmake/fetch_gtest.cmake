@@ -1,6 +1,6 @@
-# Fetch gtest through git
+# Fetch gtest through git, unless it is installed
 #
-# Targets : `libgtest` `libgmock`
+# Targets : `GTest::gtest` `GTest::gtest_main`
 
 
 if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.24.0")
@@ -9,14 +9,17 @@ endif()
 
 find_package(Threads REQUIRED)
 
-include(FetchContent)
-FetchContent_Declare(
-	googletest
-	GIT_REPOSITORY "https://github.com/google/googletest.git"
-	GIT_TAG "main"
-)
+find_package(GTest QUIET)
+if (NOT GTest_FOUND)
+	include(FetchContent)
+	FetchContent_Declare(
+		googletest
+		GIT_REPOSITORY "https://github.com/google/googletest.git"
+		GIT_TAG "main"
+	)
 
-set(gtest_force_shared_crt ON CACHE BOOL "" FORCE)
-FetchContent_MakeAvailable(googletest)
+	set(gtest_force_shared_crt ON CACHE BOOL "" FORCE)
+	FetchContent_MakeAvailable(googletest)
+endif()
 
 include(GoogleTest)
@@ -0,0 +1,98 @@
+#include "ActiveRegion.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+ActiveRegion::ActiveRegion(const poss::Mesh& mesh, const Options& options)
+    : options(options), kernel(kernel::best()) {
+    assert(options.blockSize != 0);
+    const usize size = options.blockSize;
+
+    blocksAcross = (mesh.width + size - 1) / size;
+    blocksDown = (mesh.height + size - 1) / size;
+
+    blocks.reserve(blocksAcross * blocksDown);
+    for (usize row = 0; row < mesh.height; row += size) {
+        for (usize col = 0; col < mesh.width; col += size) {
+            blocks.push_back({col, std::min(col + size, mesh.width), row,
+                              std::min(row + size, mesh.height)});
+        }
+    }
+
+    busy.assign(blocks.size(), 1);
+    nextBusy.assign(blocks.size(), 0);
+    synced.assign(blocks.size(), 0);
+}
+
+ActiveRegion::Stats ActiveRegion::step(poss::Mesh& mesh) {
+    const kernel::Step args = mesh.stepArgs();
+    const kernel::Pins pins = mesh.pins();
+    usize active = 0;
+
+    for (usize b = 0; b < blocks.size(); ++b) {
+        if (awake(b)) {
+            nextBusy[b] = run(args, pins, blocks[b]) > options.threshold;
+            synced[b] = 0;
+            ++active;
+        } else {
+            if (!synced[b]) {
+                sync(mesh, blocks[b]);
+                synced[b] = 1;
+            }
+            nextBusy[b] = 0;
+        }
+    }
+
+    std::swap(busy, nextBusy);
+    std::swap(mesh.temperature, mesh.scratch);
+
+    return {active, blocks.size()};
+}
+
+void ActiveRegion::wakeAll() {
+    std::ranges::fill(busy, 1);
+    std::ranges::fill(synced, 0);
+}
+
+bool ActiveRegion::awake(usize block) const {
+    const usize row = block / blocksAcross;
+    const usize col = block % blocksAcross;
+
+    return busy[block] || (row > 0 && busy[block - blocksAcross]) ||
+           (row + 1 < blocksDown && busy[block + blocksAcross]) ||
+           (col > 0 && busy[block - 1]) ||
+           (col + 1 < blocksAcross && busy[block + 1]);
+}
+
+// steps the block's rows and returns the largest change of one of its cells
+float ActiveRegion::run(const kernel::Step& step,
+                        const kernel::Pins& pins,
+                        const Block& block) const {
+    float change = 0.0f;
+
+    for (usize row = block.rowBegin; row < block.rowEnd; ++row) {
+        const usize begin = (row + 1) * step.stride + block.colBegin + 1;
+        const usize end = begin + (block.colEnd - block.colBegin);
+        kernel(step, begin, end);
+        pins.apply(step.dst, begin, end);
+
+        for (usize i = begin; i < end; ++i) {
+            change = std::max(change, std::fabs(step.dst[i] - step.src[i]));
+        }
+    }
+
+    return change;
+}
+
+void ActiveRegion::sync(poss::Mesh& mesh, const Block& block) const {
+    const usize count = block.colEnd - block.colBegin;
+
+    for (usize row = block.rowBegin; row < block.rowEnd; ++row) {
+        const usize begin = mesh.index(block.colBegin, row);
+        std::memcpy(mesh.scratch.data() + begin,
+                    mesh.temperature.data() + begin, count * sizeof(float));
+    }
+}
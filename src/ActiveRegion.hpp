@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "ints.hpp"
+
+// Explicit stepping that skips the parts of the mesh at equilibrium.
+//
+// The mesh is cut into square blocks of cells. A block is busy when some cell
+// in it moved by more than the threshold on its last step; it is stepped
+// while it or one of its four neighbours is busy and sleeps otherwise, so a
+// front crossing into a quiet block wakes it one step later. A sleeping
+// block's cells are made equal in both planes once and then left alone.
+//
+// With a zero threshold only blocks whose inputs did not change are skipped,
+// so the result is exactly the one of `Mesh::update`.
+class ActiveRegion {
+   public:
+    struct Options {
+        // cells along each side of a block
+        usize blockSize = 32;
+        // largest per-step change of a cell that still counts as quiet
+        float threshold = 1e-4f;
+    };
+
+    struct Stats {
+        usize active;
+        usize blocks;
+    };
+
+    ActiveRegion(const poss::Mesh& mesh, const Options& options);
+
+    // one `Mesh::update`, returns how many blocks were stepped
+    Stats step(poss::Mesh& mesh);
+
+    // wakes every block, for when the field or the thermostat setpoints were
+    // changed from outside
+    void wakeAll();
+
+   private:
+    struct Block {
+        usize colBegin, colEnd;
+        usize rowBegin, rowEnd;
+    };
+
+    [[nodiscard]] bool awake(usize block) const;
+    float run(const kernel::Step& step,
+              const kernel::Pins& pins,
+              const Block& block) const;
+    void sync(poss::Mesh& mesh, const Block& block) const;
+
+    Options options;
+    kernel::StepFn kernel;
+    usize blocksAcross, blocksDown;
+    std::vector<Block> blocks;
+    // busy on the last step, and whether both planes hold the same values
+    std::vector<u8> busy, nextBusy, synced;
+};
@@ -0,0 +1,143 @@
+#include "Adi.hpp"
+
+#include <bit>
+
+using Flag = poss::Mesh::Flag;
+
+Adi::Adi(const poss::Mesh& mesh)
+    : invCount(mesh.temperature.size(), 0.0f),
+      upper(mesh.temperature.size(), 0.0f) {
+    constexpr u8 neighbours = Flag::South | Flag::North | Flag::East |
+                              Flag::West;
+
+    for (usize i = 0; i < mesh.mask.size(); ++i) {
+        const u8 m = mesh.mask[i];
+        const int count = std::popcount(static_cast<u8>(m & neighbours));
+        if ((m & Flag::Conducts) && count != 0) {
+            invCount[i] = 1.0f / count;
+        }
+    }
+
+    // thermostats become identity rows too, which keeps them fixed through
+    // both half steps while their neighbours still see them
+    for (usize i : mesh.thermostats) {
+        invCount[i] = 0.0f;
+    }
+}
+
+void Adi::step(poss::Mesh& mesh, float dt) {
+    const float half = 0.5f * mesh.conductivity * dt;
+
+    // setpoints may have moved since the last step
+    mesh.pins().apply(mesh.temperature.data(), 0, mesh.temperature.size());
+
+    // (I - h Lx) T* = (I + h Ly) T
+    explicitColumns(mesh, mesh.temperature.data(), mesh.scratch.data(), half);
+    solveRows(mesh, mesh.scratch.data(), half);
+
+    // (I - h Ly) T' = (I + h Lx) T*
+    explicitRows(mesh, mesh.scratch.data(), mesh.temperature.data(), half);
+    solveColumns(mesh, mesh.temperature.data(), half);
+}
+
+void Adi::explicitColumns(const poss::Mesh& mesh,
+                          const float* src,
+                          float* dst,
+                          float half) const {
+    const usize stride = mesh.stride;
+
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        for (usize i = begin; i < begin + mesh.width; ++i) {
+            const u8 m = mesh.mask[i];
+            float flux = 0.0f;
+            if (m & Flag::North) {
+                flux += src[i - stride] - src[i];
+            }
+            if (m & Flag::South) {
+                flux += src[i + stride] - src[i];
+            }
+            dst[i] = src[i] + half * invCount[i] * flux;
+        }
+    }
+}
+
+void Adi::explicitRows(const poss::Mesh& mesh,
+                       const float* src,
+                       float* dst,
+                       float half) const {
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        for (usize i = begin; i < begin + mesh.width; ++i) {
+            const u8 m = mesh.mask[i];
+            float flux = 0.0f;
+            if (m & Flag::West) {
+                flux += src[i - 1] - src[i];
+            }
+            if (m & Flag::East) {
+                flux += src[i + 1] - src[i];
+            }
+            dst[i] = src[i] + half * invCount[i] * flux;
+        }
+    }
+}
+
+// Each row is an independent tridiagonal system, insulators split it into
+// decoupled segments since their off-diagonals are zero.
+void Adi::solveRows(const poss::Mesh& mesh, float* x, float half) {
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        const usize end = begin + mesh.width;
+
+        float previousUpper = 0.0f;
+        float previousX = 0.0f;
+        for (usize i = begin; i < end; ++i) {
+            const u8 m = mesh.mask[i];
+            const float a = half * invCount[i];
+            const float lower = (m & Flag::West) ? -a : 0.0f;
+            const float up = (m & Flag::East) ? -a : 0.0f;
+            const float diagonal = 1.0f - lower - up;
+
+            const float denominator = diagonal - lower * previousUpper;
+            upper[i] = up / denominator;
+            x[i] = (x[i] - lower * previousX) / denominator;
+
+            previousUpper = upper[i];
+            previousX = x[i];
+        }
+
+        float next = 0.0f;
+        for (usize i = end; i-- > begin;) {
+            x[i] -= upper[i] * next;
+            next = x[i];
+        }
+    }
+}
+
+// All columns are eliminated together one row at a time, the halo rows above
+// and below are zero so the first and last rows need no special case.
+void Adi::solveColumns(const poss::Mesh& mesh, float* x, float half) {
+    const usize stride = mesh.stride;
+
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        for (usize i = begin; i < begin + mesh.width; ++i) {
+            const u8 m = mesh.mask[i];
+            const float a = half * invCount[i];
+            const float lower = (m & Flag::North) ? -a : 0.0f;
+            const float up = (m & Flag::South) ? -a : 0.0f;
+            const float diagonal = 1.0f - lower - up;
+
+            const float denominator = diagonal - lower * upper[i - stride];
+            upper[i] = up / denominator;
+            x[i] = (x[i] - lower * x[i - stride]) / denominator;
+        }
+    }
+
+    for (usize row = mesh.height; row-- > 0;) {
+        const usize begin = mesh.index(0, row);
+        for (usize i = begin; i < begin + mesh.width; ++i) {
+            x[i] -= upper[i] * x[i + stride];
+        }
+    }
+}
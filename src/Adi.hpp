@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Peaceman-Rachford alternating direction implicit integrator.
+//
+// The mesh operator `mean(conducting neighbours) - T` splits into a row part
+// and a column part, each a tridiagonal system along its direction. A step
+// is a half step implicit along rows then a half step implicit along columns,
+// both solved with the Thomas algorithm; column solves are batched across a
+// whole row at a time so they stream through row-major memory.
+//
+// Both parts are negative semi-definite in the inner product weighted by the
+// neighbour counts, so the scheme is unconditionally stable and second order
+// in time. Insulators and thermostats are identity rows of the systems and
+// never change.
+class Adi {
+   public:
+    explicit Adi(const poss::Mesh& mesh);
+
+    void step(poss::Mesh& mesh, float dt);
+
+   private:
+    void explicitColumns(const poss::Mesh& mesh,
+                         const float* src,
+                         float* dst,
+                         float half) const;
+    void explicitRows(const poss::Mesh& mesh,
+                      const float* src,
+                      float* dst,
+                      float half) const;
+    void solveRows(const poss::Mesh& mesh, float* x, float half);
+    void solveColumns(const poss::Mesh& mesh, float* x, float half);
+
+    // 1 / number of conducting neighbours, 0 for insulators and lone cells
+    AlignedVector<float> invCount;
+    // modified upper diagonal of the Thomas algorithm
+    AlignedVector<float> upper;
+};
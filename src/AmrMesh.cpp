@@ -0,0 +1,417 @@
+#include "AmrMesh.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// harmonic mean, which is zero as soon as either side insulates
+static float faceConductivity(float a, float b) {
+    return a + b > 0.0f ? 2.0f * a * b / (a + b) : 0.0f;
+}
+
+static bool sameTile(const Tile& a, const Tile& b) {
+    return a.kind == b.kind && a.temperature == b.temperature &&
+           a.conductivity == b.conductivity;
+}
+
+std::vector<usize> AmrMesh::layoutSubdivisions(const Grid& grid,
+                                               usize maxSubdivision) {
+    const usize across = grid.width();
+    const usize down = grid.height();
+    const usize far = across + down;
+
+    // Chebyshev distance, in tiles, to a tile with something to resolve
+    std::vector<usize> distance(across * down, far);
+    for (usize row = 0; row < down; ++row) {
+        for (usize col = 0; col < across; ++col) {
+            const Tile& tile = grid.tiles[row][col];
+            if (!tile.conducts()) {
+                continue;
+            }
+            for (usize r = row; r <= row + 2; ++r) {
+                for (usize c = col; c <= col + 2; ++c) {
+                    // `r - 1` and `c - 1` wrap on the first row and column
+                    const bool outside = r == 0 || c == 0 || r > down ||
+                                         c > across;
+                    if (outside || !sameTile(tile, grid.tiles[r - 1][c - 1])) {
+                        distance[row * across + col] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    // two chamfer passes, each taking the neighbours already swept
+    for (usize row = 0; row < down; ++row) {
+        for (usize col = 0; col < across; ++col) {
+            usize& d = distance[row * across + col];
+            if (col > 0) {
+                d = std::min(d, distance[row * across + col - 1] + 1);
+            }
+            if (row > 0) {
+                for (usize c = col > 0 ? col - 1 : 0;
+                     c < std::min(col + 2, across); ++c) {
+                    d = std::min(d, distance[(row - 1) * across + c] + 1);
+                }
+            }
+        }
+    }
+    for (usize row = down; row-- > 0;) {
+        for (usize col = across; col-- > 0;) {
+            usize& d = distance[row * across + col];
+            if (col + 1 < across) {
+                d = std::min(d, distance[row * across + col + 1] + 1);
+            }
+            if (row + 1 < down) {
+                for (usize c = col > 0 ? col - 1 : 0;
+                     c < std::min(col + 2, across); ++c) {
+                    d = std::min(d, distance[(row + 1) * across + c] + 1);
+                }
+            }
+        }
+    }
+
+    std::vector<usize> subdivisions(across * down, 0);
+    for (usize row = 0; row < down; ++row) {
+        for (usize col = 0; col < across; ++col) {
+            if (!grid.tiles[row][col].conducts()) {
+                continue;
+            }
+            usize s = maxSubdivision;
+            for (usize d = distance[row * across + col]; d > 0 && s > 1; --d) {
+                s /= 2;
+            }
+            subdivisions[row * across + col] = s;
+        }
+    }
+    return subdivisions;
+}
+
+AmrMesh::AmrMesh(const Grid& grid, const poss::Mesh& mesh)
+    : AmrMesh(grid,
+              mesh,
+              layoutSubdivisions(grid, mesh.width / grid.width())) {}
+
+AmrMesh::AmrMesh(const Grid& grid,
+                 const poss::Mesh& mesh,
+                 const std::vector<usize>& subdivisions)
+    : across(grid.width()),
+      down(grid.height()),
+      maxSubdivision(mesh.width / grid.width()) {
+    assert(std::has_single_bit(maxSubdivision) &&
+           mesh.height == down * maxSubdivision &&
+           subdivisions.size() == across * down);
+
+    tiles.reserve(across * down);
+    levels.assign(across * down, 0);
+    for (usize t = 0; t < across * down; ++t) {
+        tiles.push_back(grid.tiles[t / across][t % across]);
+        if (tiles[t].conducts()) {
+            assert(std::has_single_bit(subdivisions[t]) &&
+                   subdivisions[t] <= maxSubdivision);
+            levels[t] = subdivisions[t];
+        }
+    }
+
+    link();
+
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize s = levels[t];
+        if (s == 0) {
+            continue;
+        }
+        const usize h = maxSubdivision / s;
+        const usize col0 = t % across * maxSubdivision;
+        const usize row0 = t / across * maxSubdivision;
+
+        for (usize r = 0; r < s; ++r) {
+            for (usize c = 0; c < s; ++c) {
+                float sum = 0.0f;
+                for (usize y = 0; y < h; ++y) {
+                    for (usize x = 0; x < h; ++x) {
+                        sum += mesh.temperature[mesh.index(
+                            col0 + c * h + x, row0 + r * h + y)];
+                    }
+                }
+                temperature[first[t] + r * s + c] = sum / (h * h);
+            }
+        }
+    }
+    pins().apply(temperature.data(), 0, temperature.size());
+}
+
+void AmrMesh::link() {
+    first.assign(tiles.size(), 0);
+    usize cells = 0;
+    for (usize t = 0; t < tiles.size(); ++t) {
+        first[t] = cells;
+        cells += levels[t] * levels[t];
+    }
+    assert(cells <= std::numeric_limits<u32>::max());
+    temperature.assign(cells, 0.0f);
+    scratch.assign(cells, 0.0f);
+
+    faces.clear();
+    const auto connect = [&](usize a, usize b, float coefficient) {
+        faces.push_back({static_cast<u32>(a), static_cast<u32>(b),
+                         coefficient});
+        faces.push_back({static_cast<u32>(b), static_cast<u32>(a),
+                         coefficient});
+    };
+
+    // the east (or south) edge of tile `a` against the west (north) edge of
+    // tile `b`, cut at the finer of their spacings
+    const auto join = [&](usize a, usize b, bool south) {
+        const usize sa = levels[a];
+        const usize sb = levels[b];
+        const usize n = std::max(sa, sb);
+        const float length = static_cast<float>(maxSubdivision / n);
+        const float distance = 0.5f * (width(a) + width(b));
+        const float k = faceConductivity(
+            poss::Mesh::tileConductivity(tiles[a].conductivity),
+            poss::Mesh::tileConductivity(tiles[b].conductivity));
+
+        for (usize j = 0; j < n; ++j) {
+            const usize ja = j * sa / n;
+            const usize jb = j * sb / n;
+            const usize ca = south ? first[a] + (sa - 1) * sa + ja
+                                   : first[a] + ja * sa + sa - 1;
+            const usize cb = south ? first[b] + jb : first[b] + jb * sb;
+            connect(ca, cb, 0.25f * k * length / distance);
+        }
+    };
+
+    inner.assign(tiles.size(), 0.0f);
+    thermostats.clear();
+    setpoints.clear();
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize s = levels[t];
+        if (s == 0) {
+            continue;
+        }
+        // faces inside a tile are as long as their cells are apart
+        const float h = width(t);
+        inner[t] =
+            0.25f * poss::Mesh::tileConductivity(tiles[t].conductivity) /
+            (h * h);
+
+        const usize col = t % across;
+        const usize row = t / across;
+        if (col + 1 < across && levels[t + 1] != 0) {
+            join(t, t + 1, false);
+        }
+        if (row + 1 < down && levels[t + across] != 0) {
+            join(t, t + across, true);
+        }
+
+        if (tiles[t].kind == Tile::Kind::Thermostat) {
+            for (usize i = first[t]; i < first[t] + s * s; ++i) {
+                thermostats.push_back(i);
+                setpoints.push_back(tiles[t].temperature);
+            }
+        }
+    }
+
+    // over the area of the cell it is applied to, in cell order
+    std::vector<float> total(cells, 0.0f);
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize s = levels[t];
+        for (usize r = 0; r < s; ++r) {
+            for (usize c = 0; c < s; ++c) {
+                const usize count = (r > 0) + (r + 1 < s) + (c > 0) +
+                                    (c + 1 < s);
+                total[first[t] + r * s + c] = count * inner[t];
+            }
+        }
+    }
+    for (Face& face : faces) {
+        const usize t = owner(face.from);
+        face.weight /= width(t) * width(t);
+        total[face.from] += face.weight;
+    }
+    std::ranges::sort(faces, {}, &Face::from);
+
+    float limit = std::numeric_limits<float>::infinity();
+    for (float sum : total) {
+        if (sum > 0.0f) {
+            limit = std::min(limit, 1.0f / sum);
+        }
+    }
+    // nothing conducts, any dt is stable
+    maxDt = std::isinf(limit) ? poss::Mesh::dt : limit;
+}
+
+usize AmrMesh::owner(usize cell) const {
+    // the last tile starting at or before `cell`, an insulator before it
+    // starts at the same cell
+    const auto it = std::ranges::upper_bound(first, cell);
+    return static_cast<usize>(it - first.begin()) - 1;
+}
+
+// The faces inside a tile form a plain five-point stencil over its block.
+// Missing neighbours stand in as the cell itself, which adds an exact zero.
+static void stepBlock(const float* src, float* dst, usize s, float w) {
+    for (usize r = 0; r < s; ++r) {
+        const float* line = src + r * s;
+        const float* above = r > 0 ? line - s : line;
+        const float* below = r + 1 < s ? line + s : line;
+        for (usize c = 0; c < s; ++c) {
+            const float t = line[c];
+            const float west = c > 0 ? line[c - 1] : t;
+            const float east = c + 1 < s ? line[c + 1] : t;
+            dst[r * s + c] =
+                t + w * ((above[c] - t) + (below[c] - t) + (west - t) +
+                         (east - t));
+        }
+    }
+}
+
+float AmrMesh::step() {
+    const float dt = maxDt;
+    const float* t = temperature.data();
+    float* out = scratch.data();
+
+    for (usize tile = 0; tile < tiles.size(); ++tile) {
+        if (levels[tile] != 0) {
+            stepBlock(t + first[tile], out + first[tile], levels[tile],
+                      dt * inner[tile]);
+        }
+    }
+    for (const Face& face : faces) {
+        out[face.from] += dt * face.weight * (t[face.to] - t[face.from]);
+    }
+
+    pins().apply(out, 0, scratch.size());
+    std::swap(temperature, scratch);
+    return dt;
+}
+
+bool AmrMesh::adapt(float threshold) {
+    assert(threshold > 0.0f);
+
+    std::vector<usize> next(levels.size(), 0);
+    std::vector<float> steep(levels.size(), 0.0f);
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize s = levels[t];
+        if (s == 0) {
+            continue;
+        }
+
+        // degrees per finest cell
+        const float* cells = temperature.data() + first[t];
+        float steepest = 0.0f;
+        for (usize r = 0; r < s; ++r) {
+            for (usize c = 0; c < s; ++c) {
+                const float here = cells[r * s + c];
+                if (c + 1 < s) {
+                    steepest = std::max(
+                        steepest, std::fabs(cells[r * s + c + 1] - here));
+                }
+                if (r + 1 < s) {
+                    steepest = std::max(
+                        steepest, std::fabs(cells[(r + 1) * s + c] - here));
+                }
+            }
+        }
+        steepest /= width(t);
+        steep[t] = steepest;
+    }
+    // faces between tiles, charged to both sides
+    for (const Face& face : faces) {
+        const usize a = owner(face.from);
+        const usize b = owner(face.to);
+        const float jump =
+            std::fabs(temperature[face.to] - temperature[face.from]);
+        steep[a] = std::max(steep[a], jump / width(a));
+        steep[b] = std::max(steep[b], jump / width(b));
+    }
+
+    for (usize t = 0; t < tiles.size(); ++t) {
+        if (levels[t] == 0) {
+            continue;
+        }
+        const float steepest = steep[t];
+        usize level = 1;
+        while (level < maxSubdivision &&
+               steepest * (maxSubdivision / level) > threshold) {
+            level *= 2;
+        }
+        next[t] = level;
+    }
+
+    if (next == levels) {
+        return false;
+    }
+
+    const std::vector<usize> previousLevels = std::exchange(levels, next);
+    const std::vector<usize> previousFirst = first;
+    const AlignedVector<float> previous = temperature;
+    link();
+
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize from = previousLevels[t];
+        const usize to = levels[t];
+        const float* src = previous.data() + previousFirst[t];
+        float* dst = temperature.data() + first[t];
+
+        for (usize r = 0; r < to; ++r) {
+            for (usize c = 0; c < to; ++c) {
+                if (to >= from) {
+                    dst[r * to + c] = src[r * from / to * from + c * from / to];
+                    continue;
+                }
+                const usize k = from / to;
+                float sum = 0.0f;
+                for (usize y = 0; y < k; ++y) {
+                    for (usize x = 0; x < k; ++x) {
+                        sum += src[(r * k + y) * from + c * k + x];
+                    }
+                }
+                dst[r * to + c] = sum / (k * k);
+            }
+        }
+    }
+    pins().apply(temperature.data(), 0, temperature.size());
+    return true;
+}
+
+void AmrMesh::paint(poss::Mesh& mesh) const {
+    assert(mesh.width == across * maxSubdivision &&
+           mesh.height == down * maxSubdivision);
+
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize s = levels[t];
+        if (s == 0) {
+            continue;
+        }
+        const usize h = maxSubdivision / s;
+        const usize col0 = t % across * maxSubdivision;
+        const usize row0 = t / across * maxSubdivision;
+
+        for (usize row = 0; row < maxSubdivision; ++row) {
+            const float* cells = temperature.data() + first[t] + row / h * s;
+            float* line = &mesh.temperature[mesh.index(col0, row0 + row)];
+            for (usize col = 0; col < maxSubdivision; ++col) {
+                line[col] = cells[col / h];
+            }
+        }
+    }
+}
+
+double AmrMesh::heat() const {
+    double sum = 0.0;
+    for (usize t = 0; t < tiles.size(); ++t) {
+        const usize cells = levels[t] * levels[t];
+        double tile = 0.0;
+        for (usize i = first[t]; i < first[t] + cells; ++i) {
+            tile += temperature[i];
+        }
+        if (cells != 0) {
+            sum += tile * width(t) * width(t);
+        }
+    }
+    return sum;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+
+#include "Grid.hpp"
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Block-structured adaptive mesh: every grid tile is cut into its own
+// `s x s` cells, `s` a power of two up to `maxSubdivision`, instead of the one
+// subdivision `Mesh::fromGrid` applies everywhere. Insulating tiles have no
+// cells at all.
+//
+// Lengths are counted in cells of the finest level, so a cell of a tile at
+// subdivision `s` is `maxSubdivision / s` wide. Two cells sharing a stretch of
+// edge of length `l` with centres `d` apart exchange
+//
+//     k_face / 4 * l / d * (T_b - T_a)
+//
+// per unit time, `k_face` the harmonic mean of their tiles' conductivities,
+// and each cell moves by what it gathers over its area. Where tiles of
+// different levels meet, the edge is cut at the finer spacing and every piece
+// is a face of its own, so what leaves one side enters the other and `heat()`
+// is conserved across level boundaries, to rounding.
+//
+// At the finest level and away from walls this is the operator of
+// `Mesh::update`; along walls it conserves plain heat rather than
+// `sum(count * T)`. Steps are explicit at the largest dt that keeps every
+// update positive, which the smallest cells set.
+class AmrMesh {
+   public:
+    // Levels from the layout alone: conducting tiles next to the edge of the
+    // domain or to a tile of another kind, temperature or conductivity get
+    // `maxSubdivision`, and every tile further away halves it, down to 1.
+    static std::vector<usize> layoutSubdivisions(const Grid& grid,
+                                                 usize maxSubdivision);
+
+    // `mesh` is `Mesh::fromGrid(grid, maxSubdivision)` or a field stepped from
+    // it; each cell starts at the mean of the mesh cells it covers.
+    // `subdivisions` holds one power of two per tile, row-major, and is only
+    // read for conducting tiles.
+    AmrMesh(const Grid& grid,
+            const poss::Mesh& mesh,
+            const std::vector<usize>& subdivisions);
+    AmrMesh(const Grid& grid, const poss::Mesh& mesh);
+
+    // one step at `stableDt()`, returns it
+    float step();
+
+    // Picks every tile's level again from the current field: the coarsest
+    // one across whose cells the temperature changes by at most `threshold`
+    // degrees, judged from the steepest jump between one of the tile's cells
+    // and a neighbour. Split cells inherit their parent's temperature and
+    // merged ones the mean of their children, which conserves `heat()`.
+    // Returns whether any tile changed level.
+    bool adapt(float threshold);
+
+    // Writes the field into the planes of `mesh`, laid out like the one it
+    // was built from, every cell filling its whole footprint. This is what
+    // the renderer and the output writers draw mixed levels from.
+    void paint(poss::Mesh& mesh) const;
+
+    [[nodiscard]] float stableDt() const { return maxDt; }
+    [[nodiscard]] usize cellCount() const { return temperature.size(); }
+    // per tile, row-major, 0 for insulators
+    [[nodiscard]] const std::vector<usize>& subdivisions() const {
+        return levels;
+    }
+
+    // `sum(area * T)` with areas in finest cells
+    [[nodiscard]] double heat() const;
+
+   private:
+    // lays the cells out for `levels` and builds the faces and thermostats
+    void link();
+
+    // the tile a cell belongs to
+    [[nodiscard]] usize owner(usize cell) const;
+
+    [[nodiscard]] float width(usize tile) const {
+        return static_cast<float>(maxSubdivision / levels[tile]);
+    }
+
+    [[nodiscard]] kernel::Pins pins() const {
+        return {thermostats.data(), setpoints.data(), thermostats.size()};
+    }
+
+    usize across, down;
+    usize maxSubdivision;
+    // row-major copy of the grid's tiles
+    std::vector<Tile> tiles;
+    std::vector<usize> levels;
+    // per tile, its first cell; a tile's cells are row-major
+    std::vector<usize> first;
+
+    AlignedVector<float> temperature;
+    AlignedVector<float> scratch;
+
+    // one face between two tiles, seen from `from`: its coefficient over
+    // the area of `from`
+    struct Face {
+        u32 from;
+        u32 to;
+        float weight;
+    };
+
+    // per tile, the coefficient of the faces inside it over its cells' area
+    std::vector<float> inner;
+    // both ways, sorted on `from`
+    std::vector<Face> faces;
+
+    std::vector<usize> thermostats;
+    std::vector<float> setpoints;
+
+    float maxDt;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+#include "ints.hpp"
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Reusable barrier for a fixed set of threads. Waiters spin briefly, which is
+// enough when all threads are stepping in lockstep, then park on the phase
+// counter.
+class Barrier {
+   public:
+    explicit Barrier(usize count) : count(count) {}
+
+    void arriveAndWait() {
+        const u32 current = phase.load(std::memory_order_acquire);
+
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+            waiting.store(0, std::memory_order_relaxed);
+            phase.store(current + 1, std::memory_order_release);
+            phase.notify_all();
+            return;
+        }
+
+        for (usize spin = 0; spin < spinLimit; ++spin) {
+            if (phase.load(std::memory_order_acquire) != current) {
+                return;
+            }
+            cpuRelax();
+        }
+        while (phase.load(std::memory_order_acquire) == current) {
+            phase.wait(current, std::memory_order_acquire);
+        }
+    }
+
+   private:
+    static constexpr usize spinLimit = 1 << 12;
+
+    const usize count;
+    std::atomic<usize> waiting{0};
+    std::atomic<u32> phase{0};
+};
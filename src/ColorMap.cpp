@@ -43,7 +43,29 @@ Rgb ColorMap::get(float x) const {
     return lerpRgb(low, high, offset);
 }
 
-ColorMap::ColorMap(const std::vector<Rgb>& c) : colors(c) {}
+void ColorMap::colorize(std::span<const float> values,
+                        std::span<Rgba> out,
+                        float min,
+                        float max) const {
+    // an empty range maps everything to the first entry
+    const float scale = max > min ? (lutSize - 1) / (max - min) : 0.0f;
+    const float last = static_cast<float>(lutSize - 1);
+    const Rgba* table = lut.data();
+
+    for (usize i = 0; i < values.size(); ++i) {
+        float x = (values[i] - min) * scale + 0.5f;
+        // written so that NaN lands on 0
+        x = x > 0.0f ? x : 0.0f;
+        x = x < last ? x : last;
+        out[i] = table[static_cast<usize>(x)];
+    }
+}
+
+ColorMap::ColorMap(const std::vector<Rgb>& c) : colors(c), lut(lutSize) {
+    for (usize i = 0; i < lutSize; ++i) {
+        lut[i] = get(static_cast<float>(i) / (lutSize - 1)).opaque();
+    }
+}
 
 ColorMap ColorMap::Catpuccin() {
     std::vector<Rgb> colors = {
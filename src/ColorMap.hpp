@@ -1,12 +1,25 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "Rgb.hpp"
 
 class ColorMap {
    public:
+    // resolution of the table `colorize` reads from
+    static constexpr usize lutSize = 1024;
+
     Rgb get(float x) const;
+
+    // Maps `values` from `[min, max]` onto the colour map, in one branch-free
+    // pass over a table baked at construction. `out` must be at least as long
+    // as `values`; NaNs, and every value when `max <= min`, map to `min`.
+    void colorize(std::span<const float> values,
+                  std::span<Rgba> out,
+                  float min,
+                  float max) const;
+
     static ColorMap Catpuccin();
     static ColorMap Viridis();
     static ColorMap Inferno();
@@ -15,4 +28,5 @@ class ColorMap {
     ColorMap(const std::vector<Rgb>& c);
 
     std::vector<Rgb> colors;
+    std::vector<Rgba> lut;
 };
@@ -0,0 +1,108 @@
+#include "Conduction.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using Flag = poss::Mesh::Flag;
+
+// harmonic mean, which is zero as soon as either side insulates
+static float faceConductivity(float a, float b) {
+    return a + b > 0.0f ? 2.0f * a * b / (a + b) : 0.0f;
+}
+
+Conduction::Conduction(const poss::Mesh& mesh, const Options& options)
+    : options(options) {
+    const usize size = mesh.temperature.size();
+    const usize stride = mesh.stride;
+    const float* k = mesh.cellConductivity.data();
+
+    south.assign(size, 0.0f);
+    north.assign(size, 0.0f);
+    east.assign(size, 0.0f);
+    west.assign(size, 0.0f);
+
+    float limit = std::numeric_limits<float>::infinity();
+    for (usize row = 0; row < mesh.height; ++row) {
+        for (usize col = 0; col < mesh.width; ++col) {
+            const usize i = mesh.index(col, row);
+            const u8 m = mesh.mask[i];
+            const int count = std::popcount(static_cast<u8>(
+                m & (Flag::South | Flag::North | Flag::East | Flag::West)));
+            if (!(m & Flag::Conducts) || count == 0) {
+                continue;
+            }
+
+            const float inv = 1.0f / count;
+            if (m & Flag::South) {
+                south[i] = faceConductivity(k[i], k[i + stride]) * inv;
+            }
+            if (m & Flag::North) {
+                north[i] = faceConductivity(k[i], k[i - stride]) * inv;
+            }
+            if (m & Flag::East) {
+                east[i] = faceConductivity(k[i], k[i + 1]) * inv;
+            }
+            if (m & Flag::West) {
+                west[i] = faceConductivity(k[i], k[i - 1]) * inv;
+            }
+
+            const float total = south[i] + north[i] + east[i] + west[i];
+            if (total > 0.0f) {
+                limit = std::min(limit, 1.0f / total);
+            }
+        }
+    }
+
+    // nothing conducts, any dt is stable
+    maxDt = std::isinf(limit) ? poss::Mesh::dt : limit;
+    // the first rates are not known to be smooth, so start small and let the
+    // controller grow dt
+    nextDt = options.adaptive ? maxDt / 16.0f : maxDt;
+    if (options.adaptive) {
+        rates.assign(size, 0.0f);
+    }
+}
+
+float Conduction::step(poss::Mesh& mesh) {
+    const float dt = nextDt;
+    const usize stride = mesh.stride;
+    const float* t = mesh.temperature.data();
+    float* out = mesh.scratch.data();
+    const usize begin = stride;
+    const usize end = (mesh.height + 1) * stride;
+
+    float change = 0.0f;
+    for (usize i = begin; i < end; ++i) {
+        const float r = south[i] * (t[i + stride] - t[i]) +
+                        north[i] * (t[i - stride] - t[i]) +
+                        east[i] * (t[i + 1] - t[i]) +
+                        west[i] * (t[i - 1] - t[i]);
+        out[i] = t[i] + dt * r;
+
+        if (options.adaptive) {
+            change = std::max(change, std::fabs(r - rates[i]));
+            rates[i] = r;
+        }
+    }
+
+    mesh.pins().apply(out, begin, end);
+    std::swap(mesh.temperature, mesh.scratch);
+
+    // Forward Euler's local error is about `dt^2 / 2 * |dr/dt|`, with the
+    // rate derivative taken over the previous step. The next dt brings it to
+    // the tolerance, growing at most twofold per step.
+    if (options.adaptive && previousDt > 0.0f) {
+        float target = maxDt;
+        if (change > 0.0f) {
+            target = 0.9f * std::sqrt(2.0f * options.tolerance * previousDt /
+                                      change);
+        }
+        nextDt = std::min({target, 2.0f * dt, maxDt});
+    }
+    previousDt = dt;
+
+    return dt;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Explicit integrator for `Mesh::cellConductivity`.
+//
+// Each face conducts with the harmonic mean of its two cells, so a poor
+// conductor dominates the faces it touches, and a cell moves by the sum of
+// its face fluxes over its neighbour count:
+//
+//     T += dt / count * sum(k_face * (T_n - T))
+//
+// With a uniform field this is the operator of `Mesh::update`, and the heat
+// `sum(count * T)` is conserved the same way.
+//
+// The step stays positive, hence stable, while `dt * sum(k_face) / count <= 1`
+// for every cell; `stableDt` is the largest such dt, `1 / conductivity` for a
+// uniform field. The scheme is written per cell like the fused kernels, so the
+// mesh spacing is one cell and `tileSize` does not enter it.
+class Conduction {
+   public:
+    struct Options {
+        // Adapts dt to keep the local error of each step, estimated from how
+        // much the rates changed since the previous one, under `tolerance`
+        // degrees. dt never exceeds `stableDt`.
+        bool adaptive = false;
+        float tolerance = 0.01f;
+    };
+
+    Conduction(const poss::Mesh& mesh, const Options& options);
+
+    [[nodiscard]] float stableDt() const { return maxDt; }
+    // the dt the next `step` takes
+    [[nodiscard]] float dt() const { return nextDt; }
+
+    // one step into `scratch`, which then becomes the field; returns the dt
+    // that was taken
+    float step(poss::Mesh& mesh);
+
+   private:
+    Options options;
+
+    // per cell, the conductivity of each face over the neighbour count,
+    // zero where the face does not conduct
+    AlignedVector<float> south, north, east, west;
+    // rates of the previous step, for the adaptive error estimate
+    AlignedVector<float> rates;
+    float previousDt = 0.0f;
+
+    float maxDt;
+    float nextDt;
+};
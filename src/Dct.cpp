@@ -0,0 +1,196 @@
+#include "Dct.hpp"
+
+#include <algorithm>
+#include <numbers>
+
+using Complex = std::complex<double>;
+
+// without the NaN recovery of `operator*`, which the compiler cannot drop
+static Complex multiply(Complex a, Complex b) {
+    return {a.real() * b.real() - a.imag() * b.imag(),
+            a.real() * b.imag() + a.imag() * b.real()};
+}
+
+Dct::Dct(usize n) : n(n), twiddles(n), shifts(n), reordered(n), spectrum(n) {
+    usize left = n;
+    usize radix = 4;
+    while (left > 1) {
+        while (left % radix != 0) {
+            radix = radix == 4 ? 2 : radix == 2 ? 3 : radix + 2;
+            if (radix * radix > left) {
+                radix = left;
+            }
+        }
+        left /= radix;
+        factors.push_back(radix);
+        factors.push_back(left);
+    }
+    if (factors.empty()) {
+        factors = {1, 1};
+    }
+
+    usize largest = 1;
+    for (usize f = 0; f < factors.size(); f += 2) {
+        largest = std::max(largest, factors[f]);
+    }
+    scratch.resize(largest);
+
+    for (usize k = 0; k < n; ++k) {
+        const double turn = -2.0 * std::numbers::pi * k / n;
+        twiddles[k] = std::polar(1.0, turn);
+        shifts[k] = std::polar(1.0, -std::numbers::pi * k / (2.0 * n));
+    }
+}
+
+// Even entries first, then the odd ones backwards, make the cosine sum the
+// real part of a shifted DFT.
+void Dct::forward(double* x) {
+    for (usize i = 0; i < n; ++i) {
+        const usize at = i % 2 == 0 ? i / 2 : n - 1 - i / 2;
+        reordered[at] = x[i];
+    }
+    fft(reordered.data(), spectrum.data());
+    for (usize k = 0; k < n; ++k) {
+        x[k] = multiply(shifts[k], spectrum[k]).real();
+    }
+}
+
+// The shifted DFT of a real sequence has `W[N - k] = -i conj(W[k])`, so its
+// imaginary parts are the cosine sums read backwards.
+void Dct::inverse(double* x) {
+    for (usize k = 0; k < n; ++k) {
+        const Complex w(x[k], k == 0 ? 0.0 : -x[n - k]);
+        // conjugated on the way in and out, the forward FFT runs backwards
+        reordered[k] = std::conj(multiply(std::conj(shifts[k]), w));
+    }
+    fft(reordered.data(), spectrum.data());
+    const double scale = 1.0 / static_cast<double>(n);
+    for (usize i = 0; i < n; ++i) {
+        const usize at = i % 2 == 0 ? i / 2 : n - 1 - i / 2;
+        x[i] = spectrum[at].real() * scale;
+    }
+}
+
+// The DFTs of two real sequences are the even and odd halves, under
+// `k -> N - k` and conjugation, of the DFT of the first plus i times the
+// second.
+void Dct::forward(double* x, double* y) {
+    for (usize i = 0; i < n; ++i) {
+        const usize at = i % 2 == 0 ? i / 2 : n - 1 - i / 2;
+        reordered[at] = {x[i], y[i]};
+    }
+    fft(reordered.data(), spectrum.data());
+    for (usize k = 0; k < n; ++k) {
+        const Complex mirror = std::conj(spectrum[k == 0 ? 0 : n - k]);
+        const Complex first = 0.5 * (spectrum[k] + mirror);
+        const Complex second = 0.5 * (spectrum[k] - mirror);
+        x[k] = multiply(shifts[k], first).real();
+        // second = i times the DFT of y
+        y[k] = multiply(shifts[k], second).imag();
+    }
+}
+
+// Both results are real, so one transform carries them as its real and
+// imaginary parts.
+void Dct::inverse(double* x, double* y) {
+    for (usize k = 0; k < n; ++k) {
+        const Complex first(x[k], k == 0 ? 0.0 : -x[n - k]);
+        const Complex second(y[k], k == 0 ? 0.0 : -y[n - k]);
+        const Complex w = first + Complex(-second.imag(), second.real());
+        reordered[k] = std::conj(multiply(std::conj(shifts[k]), w));
+    }
+    fft(reordered.data(), spectrum.data());
+    const double scale = 1.0 / static_cast<double>(n);
+    for (usize i = 0; i < n; ++i) {
+        const usize at = i % 2 == 0 ? i / 2 : n - 1 - i / 2;
+        x[i] = spectrum[at].real() * scale;
+        y[i] = -spectrum[at].imag() * scale;
+    }
+}
+
+void Dct::fft(const Complex* in, Complex* out) {
+    fftStage(out, in, 1, factors.data());
+}
+
+// Decimation in time: the `p` interleaved subsequences are transformed into
+// consecutive runs of `m`, then combined by one radix-p pass.
+void Dct::fftStage(Complex* out,
+                   const Complex* in,
+                   usize inStride,
+                   const usize* factor) {
+    const usize p = factor[0];
+    const usize m = factor[1];
+    if (m == 1) {
+        for (usize j = 0; j < p; ++j) {
+            out[j] = in[j * inStride];
+        }
+    } else {
+        for (usize j = 0; j < p; ++j) {
+            fftStage(out + j * m, in + j * inStride, inStride * p, factor + 2);
+        }
+    }
+
+    switch (p) {
+        case 1:
+            break;
+        case 2:
+            butterfly2(out, inStride, m);
+            break;
+        case 4:
+            butterfly4(out, inStride, m);
+            break;
+        default:
+            butterfly(out, inStride, m, p);
+            break;
+    }
+}
+
+void Dct::butterfly2(Complex* out, usize twiddleStride, usize m) const {
+    for (usize k = 0; k < m; ++k) {
+        const Complex t = multiply(out[k + m], twiddles[k * twiddleStride]);
+        out[k + m] = out[k] - t;
+        out[k] += t;
+    }
+}
+
+void Dct::butterfly4(Complex* out, usize twiddleStride, usize m) const {
+    for (usize k = 0; k < m; ++k) {
+        const Complex a = out[k];
+        const Complex b = multiply(out[k + m], twiddles[k * twiddleStride]);
+        const Complex c =
+            multiply(out[k + 2 * m], twiddles[2 * k * twiddleStride]);
+        const Complex d =
+            multiply(out[k + 3 * m], twiddles[3 * k * twiddleStride]);
+
+        const Complex sum = a + c;
+        const Complex difference = a - c;
+        const Complex outer = b + d;
+        // -i (b - d)
+        const Complex inner((b - d).imag(), -(b - d).real());
+
+        out[k] = sum + outer;
+        out[k + m] = difference + inner;
+        out[k + 2 * m] = sum - outer;
+        out[k + 3 * m] = difference - inner;
+    }
+}
+
+void Dct::butterfly(Complex* out, usize twiddleStride, usize m, usize p) {
+    for (usize u = 0; u < m; ++u) {
+        for (usize q = 0; q < p; ++q) {
+            scratch[q] = out[u + q * m];
+        }
+        for (usize q = 0; q < p; ++q) {
+            const usize k = u + q * m;
+            Complex sum = scratch[0];
+            // `twiddleStride * k` is below n, so one wrap keeps it in range
+            usize twiddle = 0;
+            for (usize j = 1; j < p; ++j) {
+                twiddle += twiddleStride * k;
+                twiddle -= twiddle >= n ? n : 0;
+                sum += multiply(scratch[j], twiddles[twiddle]);
+            }
+            out[k] = sum;
+        }
+    }
+}
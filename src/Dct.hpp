@@ -0,0 +1,58 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "ints.hpp"
+
+// Type II discrete cosine transform of one length and its inverse, on a
+// mixed-radix FFT of that same length.
+//
+// The cosines `cos(pi k (2n + 1) / 2N)` are the eigenvectors of the 1D
+// Laplacian with insulated ends, where a cell past either end reads as the end
+// cell itself, with eigenvalues `2 - 2 cos(pi k / N)`; see `Spectral`.
+//
+// The FFT is Cooley-Tukey over the factors of N, radix 4 and 2 first, then 3,
+// 5 and on up to the remaining primes, so any length works and lengths made
+// of small primes take O(N log N). Both transforms go through one complex FFT
+// of length N, reordering the input as in Makhoul's algorithm.
+class Dct {
+   public:
+    explicit Dct(usize n);
+
+    // X[k] = sum over n of x[n] cos(pi k (2n + 1) / 2N), in place
+    void forward(double* x);
+    // the exact inverse of `forward`, in place
+    void inverse(double* x);
+
+    // both on two sequences at once, for about the cost of one
+    void forward(double* x, double* y);
+    void inverse(double* x, double* y);
+
+    [[nodiscard]] usize size() const { return n; }
+
+   private:
+    using Complex = std::complex<double>;
+
+    // `out[k] = sum over j of in[j] e^(-2 pi i jk / N)`
+    void fft(const Complex* in, Complex* out);
+    void fftStage(Complex* out,
+                  const Complex* in,
+                  usize inStride,
+                  const usize* factor);
+    void butterfly2(Complex* out, usize twiddleStride, usize m) const;
+    void butterfly4(Complex* out, usize twiddleStride, usize m) const;
+    void butterfly(Complex* out, usize twiddleStride, usize m, usize p);
+
+    usize n;
+    // pairs of a radix and the length left below it
+    std::vector<usize> factors;
+    // e^(-2 pi i k / N)
+    std::vector<Complex> twiddles;
+    // e^(-i pi k / 2N)
+    std::vector<Complex> shifts;
+    std::vector<Complex> reordered;
+    std::vector<Complex> spectrum;
+    // one radix's worth, for the generic butterfly
+    std::vector<Complex> scratch;
+};
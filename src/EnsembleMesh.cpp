@@ -0,0 +1,353 @@
+#include "EnsembleMesh.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HEATFLOW_X86 1
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "Profiler.hpp"
+
+using Flag = poss::Mesh::Flag;
+
+namespace {
+struct Args {
+    const float* src;
+    float* dst;
+    const u8* mask;
+    // floats from a cell to the one below it
+    usize below;
+    usize lanes;
+    const float* conductivity;
+    const float* dt;
+};
+
+using StepFn = void (*)(const Args& args, usize begin, usize end);
+}  // namespace
+
+// conducting neighbours of a cell, 0 when it does not conduct
+static inline float neighbours(u8 m) {
+    if (!(m & Flag::Conducts)) {
+        return 0.0f;
+    }
+    return static_cast<float>(std::popcount(static_cast<u8>(
+        m & (Flag::South | Flag::North | Flag::East | Flag::West))));
+}
+
+// Cells that do not move are copied, the others sum their neighbours in the
+// kernels' order; a missing neighbour's `+ 0.0f` is exact and left out.
+static void stepScalar(const Args& a, usize begin, usize end) {
+    for (usize i = begin; i < end; ++i) {
+        const u8 m = a.mask[i];
+        const float* t = a.src + i * a.lanes;
+        float* d = a.dst + i * a.lanes;
+        const float count = neighbours(m);
+        if (count == 0.0f) {
+            std::memcpy(d, t, a.lanes * sizeof(float));
+            continue;
+        }
+
+        for (usize l = 0; l < a.lanes; ++l) {
+            float sum = 0.0f;
+            if (m & Flag::South) {
+                sum += t[l + a.below];
+            }
+            if (m & Flag::North) {
+                sum += t[l - a.below];
+            }
+            if (m & Flag::East) {
+                sum += t[l + a.lanes];
+            }
+            if (m & Flag::West) {
+                sum += t[l - a.lanes];
+            }
+            const float laplacian = sum / count - t[l];
+            d[l] = t[l] + a.conductivity[l] * laplacian * a.dt[l];
+        }
+    }
+}
+
+#ifdef HEATFLOW_X86
+
+__attribute__((target("sse4.1"))) static void stepSse41(const Args& a,
+                                                        usize begin,
+                                                        usize end) {
+    for (usize i = begin; i < end; ++i) {
+        const u8 m = a.mask[i];
+        const float* t = a.src + i * a.lanes;
+        float* d = a.dst + i * a.lanes;
+        const float count = neighbours(m);
+        if (count == 0.0f) {
+            std::memcpy(d, t, a.lanes * sizeof(float));
+            continue;
+        }
+
+        const __m128 n = _mm_set1_ps(count);
+        for (usize l = 0; l < a.lanes; l += 4) {
+            __m128 sum = _mm_setzero_ps();
+            if (m & Flag::South) {
+                sum = _mm_add_ps(sum, _mm_load_ps(t + l + a.below));
+            }
+            if (m & Flag::North) {
+                sum = _mm_add_ps(sum, _mm_load_ps(t + l - a.below));
+            }
+            if (m & Flag::East) {
+                sum = _mm_add_ps(sum, _mm_load_ps(t + l + a.lanes));
+            }
+            if (m & Flag::West) {
+                sum = _mm_add_ps(sum, _mm_load_ps(t + l - a.lanes));
+            }
+            const __m128 here = _mm_load_ps(t + l);
+            const __m128 laplacian = _mm_sub_ps(_mm_div_ps(sum, n), here);
+            const __m128 rate =
+                _mm_mul_ps(_mm_load_ps(a.conductivity + l), laplacian);
+            const __m128 dt = _mm_load_ps(a.dt + l);
+            _mm_store_ps(d + l, _mm_add_ps(here, _mm_mul_ps(rate, dt)));
+        }
+    }
+}
+
+__attribute__((target("avx2"))) static void stepAvx2(const Args& a,
+                                                     usize begin,
+                                                     usize end) {
+    for (usize i = begin; i < end; ++i) {
+        const u8 m = a.mask[i];
+        const float* t = a.src + i * a.lanes;
+        float* d = a.dst + i * a.lanes;
+        const float count = neighbours(m);
+        if (count == 0.0f) {
+            std::memcpy(d, t, a.lanes * sizeof(float));
+            continue;
+        }
+
+        const __m256 n = _mm256_set1_ps(count);
+        for (usize l = 0; l < a.lanes; l += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            if (m & Flag::South) {
+                sum = _mm256_add_ps(sum, _mm256_load_ps(t + l + a.below));
+            }
+            if (m & Flag::North) {
+                sum = _mm256_add_ps(sum, _mm256_load_ps(t + l - a.below));
+            }
+            if (m & Flag::East) {
+                sum = _mm256_add_ps(sum, _mm256_load_ps(t + l + a.lanes));
+            }
+            if (m & Flag::West) {
+                sum = _mm256_add_ps(sum, _mm256_load_ps(t + l - a.lanes));
+            }
+            const __m256 here = _mm256_load_ps(t + l);
+            const __m256 laplacian =
+                _mm256_sub_ps(_mm256_div_ps(sum, n), here);
+            const __m256 rate =
+                _mm256_mul_ps(_mm256_load_ps(a.conductivity + l), laplacian);
+            const __m256 dt = _mm256_load_ps(a.dt + l);
+            _mm256_store_ps(d + l,
+                            _mm256_add_ps(here, _mm256_mul_ps(rate, dt)));
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static void stepAvx512(const Args& a,
+                                                          usize begin,
+                                                          usize end) {
+    for (usize i = begin; i < end; ++i) {
+        const u8 m = a.mask[i];
+        const float* t = a.src + i * a.lanes;
+        float* d = a.dst + i * a.lanes;
+        const float count = neighbours(m);
+        if (count == 0.0f) {
+            std::memcpy(d, t, a.lanes * sizeof(float));
+            continue;
+        }
+
+        const __m512 n = _mm512_set1_ps(count);
+        for (usize l = 0; l < a.lanes; l += 16) {
+            __m512 sum = _mm512_setzero_ps();
+            if (m & Flag::South) {
+                sum = _mm512_add_ps(sum, _mm512_load_ps(t + l + a.below));
+            }
+            if (m & Flag::North) {
+                sum = _mm512_add_ps(sum, _mm512_load_ps(t + l - a.below));
+            }
+            if (m & Flag::East) {
+                sum = _mm512_add_ps(sum, _mm512_load_ps(t + l + a.lanes));
+            }
+            if (m & Flag::West) {
+                sum = _mm512_add_ps(sum, _mm512_load_ps(t + l - a.lanes));
+            }
+            const __m512 here = _mm512_load_ps(t + l);
+            const __m512 laplacian =
+                _mm512_sub_ps(_mm512_div_ps(sum, n), here);
+            const __m512 rate =
+                _mm512_mul_ps(_mm512_load_ps(a.conductivity + l), laplacian);
+            const __m512 dt = _mm512_load_ps(a.dt + l);
+            _mm512_store_ps(d + l,
+                            _mm512_add_ps(here, _mm512_mul_ps(rate, dt)));
+        }
+    }
+}
+
+#endif
+
+static StepFn select(kernel::Isa isa) {
+#ifdef HEATFLOW_X86
+    switch (isa) {
+        case kernel::Isa::Scalar:
+            return stepScalar;
+        case kernel::Isa::Sse41:
+            return stepSse41;
+        case kernel::Isa::Avx2:
+            return stepAvx2;
+        case kernel::Isa::Avx512:
+            return stepAvx512;
+    }
+#endif
+    (void)isa;
+    return stepScalar;
+}
+
+// floats per vector of the kernel for `isa`, which lanes are padded to
+static usize vectorWidth(kernel::Isa isa) {
+    switch (isa) {
+        case kernel::Isa::Scalar:
+            return 1;
+        case kernel::Isa::Sse41:
+            return 4;
+        case kernel::Isa::Avx2:
+            return 8;
+        case kernel::Isa::Avx512:
+            return 16;
+    }
+    return 1;
+}
+
+static usize padLanes(usize members, kernel::Isa isa) {
+    const usize width = vectorWidth(isa);
+    return (members + width - 1) / width * width;
+}
+
+static usize vectorCount(usize members, kernel::Isa isa) {
+    return padLanes(members, isa) / vectorWidth(isa);
+}
+
+// the narrowest supported kernel that steps a cell in as few vectors as the
+// detected one, so a handful of members is not spread over a whole AVX-512
+// vector
+static kernel::Isa pickIsa(usize members) {
+    const kernel::Isa best = kernel::detect();
+    kernel::Isa isa = best;
+    for (kernel::Isa candidate : {kernel::Isa::Avx2, kernel::Isa::Sse41}) {
+        if (candidate < best && kernel::supported(candidate) &&
+            vectorCount(members, candidate) <= vectorCount(members, isa)) {
+            isa = candidate;
+        }
+    }
+    return isa;
+}
+
+EnsembleMesh::EnsembleMesh(const poss::Mesh& mesh,
+                           std::span<const Member> members)
+    : width(mesh.width),
+      height(mesh.height),
+      stride(mesh.stride),
+      members(members.size()),
+      isa(pickIsa(members.size())),
+      lanes(padLanes(members.size(), isa)),
+      mask(mesh.mask),
+      thermostats(mesh.thermostats) {
+    assert(!members.empty());
+
+    temperature.assign(mesh.temperature.size() * lanes, 0.0f);
+    scratch.assign(temperature.size(), 0.0f);
+    setpoints.assign(thermostats.size() * lanes, 0.0f);
+
+    // padding lanes neither conduct nor advance
+    conductivity.assign(lanes, 0.0f);
+    dt.assign(lanes, 0.0f);
+    for (usize m = 0; m < members.size(); ++m) {
+        conductivity[m] = members[m].conductivity;
+        dt[m] = members[m].dt;
+        load(m, mesh);
+    }
+}
+
+void EnsembleMesh::load(usize member, const poss::Mesh& mesh) {
+    assert(member < members && mesh.stride == stride &&
+           mesh.thermostats == thermostats);
+
+    for (usize i = 0; i < mesh.temperature.size(); ++i) {
+        temperature[i * lanes + member] = mesh.temperature[i];
+    }
+    for (usize p = 0; p < thermostats.size(); ++p) {
+        setpoints[p * lanes + member] = mesh.setpoints[p];
+    }
+}
+
+void EnsembleMesh::extract(usize member, poss::Mesh& mesh) const {
+    assert(member < members && mesh.stride == stride);
+
+    for (usize i = 0; i < mesh.temperature.size(); ++i) {
+        mesh.temperature[i] = temperature[i * lanes + member];
+    }
+}
+
+// as for `Mesh::advance`: both planes and the mask of the rows taking part in
+// a wavefront must stay cache resident
+static constexpr usize wavefrontBudget = 512 * 1024;
+
+void EnsembleMesh::update(usize steps) {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    const StepFn step = select(isa);
+    const usize rowBytes = stride * (2 * lanes * sizeof(float) + sizeof(u8));
+    const usize fit = wavefrontBudget / rowBytes;
+    const usize depth = fit > 3 ? fit - 2 : 1;
+
+    float* planes[2] = {temperature.data(), scratch.data()};
+    Args args = {
+        .src = nullptr,
+        .dst = nullptr,
+        .mask = mask.data(),
+        .below = stride * lanes,
+        .lanes = lanes,
+        .conductivity = conductivity.data(),
+        .dt = dt.data(),
+    };
+
+    // the wavefront of `Mesh::advance`, a row at a time
+    for (usize done = 0; done < steps;) {
+        const usize block = std::min(depth, steps - done);
+
+        for (usize front = 1; front < height + block; ++front) {
+            for (usize s = 0; s < block; ++s) {
+                if (front < s + 1 || front - s > height) {
+                    continue;
+                }
+                const usize row = front - s;
+                args.src = planes[(done + s) % 2];
+                args.dst = planes[(done + s + 1) % 2];
+                step(args, row * stride, (row + 1) * stride);
+                pin(args.dst, row * stride, (row + 1) * stride);
+            }
+        }
+
+        done += block;
+    }
+
+    if (steps % 2 == 1) {
+        std::swap(temperature, scratch);
+    }
+}
+
+void EnsembleMesh::pin(float* plane, usize begin, usize end) const {
+    const auto first = std::ranges::lower_bound(thermostats, begin);
+    for (auto c = first; c != thermostats.end() && *c < end; ++c) {
+        const usize p = static_cast<usize>(c - thermostats.begin());
+        std::memcpy(plane + *c * lanes, &setpoints[p * lanes],
+                    lanes * sizeof(float));
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Many variants of one layout stepped together with the explicit scheme of
+// `Mesh::update`.
+//
+// Members share the geometry, the mask and the thermostat cells; each has its
+// own field, setpoints, conductivity and dt. The planes are laid out like
+// those of `poss::Mesh` with every cell widened to `laneCount()` floats, one
+// per member, so a cell's mask and neighbour offsets are looked up once and
+// the arithmetic runs in SIMD across members. Lanes are padded to the vector
+// width of the kernel, the narrowest supported one that needs no more vectors
+// than the widest, so padding costs less than a vector and never moves.
+//
+// Every member goes through the same float operations as the fused kernels,
+// so it matches a `poss::Mesh` with its parameters stepped by `update` bit for
+// bit.
+class EnsembleMesh {
+   public:
+    struct Member {
+        float conductivity = poss::Mesh::conductivity;
+        float dt = poss::Mesh::dt;
+    };
+
+    // every member starts from the field and setpoints of `mesh`
+    EnsembleMesh(const poss::Mesh& mesh, std::span<const Member> members);
+
+    // takes the field and setpoints of `mesh`, which must have the layout and
+    // mask the ensemble was built from, for one member
+    void load(usize member, const poss::Mesh& mesh);
+
+    // writes one member's field into the temperature plane of such a mesh,
+    // for the renderer or the output writers
+    void extract(usize member, poss::Mesh& mesh) const;
+
+    // temporally blocked like `Mesh::advance`, which it matches
+    void update(usize steps);
+
+    [[nodiscard]] usize memberCount() const { return members; }
+    [[nodiscard]] usize laneCount() const { return lanes; }
+    [[nodiscard]] usize cellCount() const { return width * height; }
+
+   private:
+    // re-imposes the setpoints of the cells in `[begin, end)`
+    void pin(float* plane, usize begin, usize end) const;
+
+    usize width, height, stride;
+    usize members;
+    // before `lanes`, which are padded to its vector width
+    kernel::Isa isa;
+    usize lanes;
+
+    // `lanes` floats per cell of the padded mesh planes
+    AlignedVector<float> temperature;
+    AlignedVector<float> scratch;
+    AlignedVector<u8> mask;
+    AlignedVector<float> conductivity;
+    AlignedVector<float> dt;
+
+    std::vector<usize> thermostats;
+    // `lanes` per thermostat
+    AlignedVector<float> setpoints;
+};
@@ -0,0 +1,258 @@
+#include "Frames.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <string>
+
+#include "Profiler.hpp"
+
+// BT.601 studio range, in 8.8 fixed point
+static u8 luma(Rgba c) {
+    return static_cast<u8>(
+        ((66 * c.red + 129 * c.green + 25 * c.blue + 128) >> 8) + 16);
+}
+
+static u8 blueDifference(Rgba c) {
+    return static_cast<u8>(
+        ((-38 * c.red - 74 * c.green + 112 * c.blue + 128) >> 8) + 128);
+}
+
+static u8 redDifference(Rgba c) {
+    return static_cast<u8>(
+        ((112 * c.red - 94 * c.green - 18 * c.blue + 128) >> 8) + 128);
+}
+
+static usize resolveWorkers(usize workers) {
+    if (workers != 0) {
+        return workers;
+    }
+    const usize hardware = std::thread::hardware_concurrency();
+    return hardware > 2 ? hardware / 2 : 1;
+}
+
+FrameWriter::Format FrameWriter::formatFor(const std::string& path) {
+    return path == "-" || path.ends_with(".y4m") ? Format::Y4m : Format::Ppm;
+}
+
+FrameWriter::FrameWriter(const std::string& path,
+                         const poss::Mesh& mesh,
+                         const ColorMap& cmap,
+                         const Options& options)
+    : width(mesh.width),
+      height(mesh.height),
+      path(path),
+      options(options),
+      cmap(cmap) {
+    if (this->options.scale == 0) {
+        this->options.scale = 1;
+    }
+
+    if (options.format == Format::Y4m) {
+        file = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+        // frames pushed anyway are encoded and counted as failed writes
+        const std::string header =
+            "YUV4MPEG2 W" + std::to_string(width * this->options.scale) +
+            " H" + std::to_string(height * this->options.scale) + " F" +
+            std::to_string(options.fps) + ":1 Ip A1:1 C444\n";
+        failed = file == nullptr ||
+                 std::fwrite(header.data(), 1, header.size(), file) !=
+                     header.size();
+        bytes = header.size();
+    }
+
+    conducts.resize(width * height);
+    for (usize row = 0; row < height; ++row) {
+        for (usize col = 0; col < width; ++col) {
+            conducts[row * width + col] = mesh.conducts(col, row);
+        }
+    }
+
+    slots.resize(std::max<usize>(options.buffers, 1));
+    for (Slot& slot : slots) {
+        slot.field.resize(width * height);
+    }
+
+    const usize count = resolveWorkers(options.workers);
+    for (usize worker = 0; worker < count; ++worker) {
+        workers.emplace_back([this, worker] {
+            profile::nameThread("frames " + std::to_string(worker));
+            this->work();
+        });
+    }
+    writer = std::thread([this] { this->write(); });
+}
+
+bool FrameWriter::ok() const {
+    const std::lock_guard lock(mutex);
+    return !failed;
+}
+
+void FrameWriter::push(const poss::Mesh& mesh) {
+    std::unique_lock lock(mutex);
+    Slot& slot = slots[head % slots.size()];
+    changed.wait(lock, [&] { return slot.state == State::Free; });
+    lock.unlock();
+
+    // the slot is ours until it is marked filled
+    for (usize row = 0; row < height; ++row) {
+        std::memcpy(slot.field.data() + row * width,
+                    mesh.temperature.data() + mesh.index(0, row),
+                    width * sizeof(float));
+    }
+
+    lock.lock();
+    slot.state = State::Filled;
+    slot.frame = head++;
+    changed.notify_all();
+}
+
+void FrameWriter::close() {
+    {
+        const std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    if (file != nullptr) {
+        const bool flushed = file == stdout ? std::fflush(file) == 0
+                                            : std::fclose(file) == 0;
+        const std::lock_guard lock(mutex);
+        failed = failed || !flushed;
+        file = nullptr;
+    }
+}
+
+FrameWriter::Stats FrameWriter::stats() const {
+    const std::lock_guard lock(mutex);
+    return {static_cast<usize>(tail), bytes};
+}
+
+void FrameWriter::work() {
+    while (true) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return claimed < head || stopping; });
+        if (claimed == head) {
+            return;
+        }
+        Slot& slot = slots[claimed++ % slots.size()];
+        lock.unlock();
+
+        encode(slot);
+
+        lock.lock();
+        slot.state = State::Encoded;
+        changed.notify_all();
+    }
+}
+
+void FrameWriter::write() {
+    while (true) {
+        std::unique_lock lock(mutex);
+        Slot& slot = slots[tail % slots.size()];
+        changed.wait(lock, [&] {
+            return (tail < head && slot.state == State::Encoded) ||
+                   (stopping && tail == head);
+        });
+        if (tail == head) {
+            return;
+        }
+        lock.unlock();
+
+        bool written = false;
+        if (options.format == Format::Y4m) {
+            written = file != nullptr &&
+                      std::fwrite(slot.bytes.data(), 1, slot.bytes.size(),
+                                  file) == slot.bytes.size();
+        } else {
+            std::string number = std::to_string(slot.frame);
+            number.insert(0, number.size() < 6 ? 6 - number.size() : 0, '0');
+            std::FILE* image =
+                std::fopen((path + number + ".ppm").c_str(), "wb");
+            if (image != nullptr) {
+                written = std::fwrite(slot.bytes.data(), 1, slot.bytes.size(),
+                                      image) == slot.bytes.size();
+                written = std::fclose(image) == 0 && written;
+            }
+        }
+
+        lock.lock();
+        failed = failed || !written;
+        bytes += slot.bytes.size();
+        slot.state = State::Free;
+        ++tail;
+        changed.notify_all();
+    }
+}
+
+void FrameWriter::encode(Slot& slot) const {
+    HEATFLOW_PROFILE_SCOPE(Colorize);
+    const usize scale = options.scale;
+    const usize pixelsAcross = width * scale;
+    const usize pixels = pixelsAcross * height * scale;
+    const Rgba background = catpuccin::DarkGray.opaque();
+
+    std::vector<Rgba> line(width);
+    std::vector<u8>& out = slot.bytes;
+    out.clear();
+
+    const std::string header =
+        options.format == Format::Y4m
+            ? std::string("FRAME\n")
+            : "P6\n" + std::to_string(pixelsAcross) + " " +
+                  std::to_string(height * scale) + "\n255\n";
+    out.assign(header.begin(), header.end());
+    out.resize(header.size() + 3 * pixels);
+    u8* const body = out.data() + header.size();
+
+    for (usize row = 0; row < height; ++row) {
+        cmap.colorize({slot.field.data() + row * width, width}, line, 0.0f,
+                      255.0f);
+        for (usize col = 0; col < width; ++col) {
+            if (!conducts[row * width + col]) {
+                line[col] = background;
+            }
+        }
+
+        // the first pixel row of the cell row, then copies of it
+        const usize first = row * scale * pixelsAcross;
+        if (options.format == Format::Ppm) {
+            u8* p = body + 3 * first;
+            for (usize col = 0; col < width; ++col) {
+                for (usize x = 0; x < scale; ++x) {
+                    *p++ = line[col].red;
+                    *p++ = line[col].green;
+                    *p++ = line[col].blue;
+                }
+            }
+            for (usize y = 1; y < scale; ++y) {
+                std::memcpy(body + 3 * (first + y * pixelsAcross),
+                            body + 3 * first, 3 * pixelsAcross);
+            }
+            continue;
+        }
+
+        u8* planes[3] = {body + first, body + pixels + first,
+                         body + 2 * pixels + first};
+        for (usize col = 0; col < width; ++col) {
+            std::fill_n(planes[0] + col * scale, scale, luma(line[col]));
+            std::fill_n(planes[1] + col * scale, scale,
+                        blueDifference(line[col]));
+            std::fill_n(planes[2] + col * scale, scale,
+                        redDifference(line[col]));
+        }
+        for (u8* plane : planes) {
+            for (usize y = 1; y < scale; ++y) {
+                std::memcpy(plane + y * pixelsAcross, plane, pixelsAcross);
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ColorMap.hpp"
+#include "Mesh.hpp"
+#include "ints.hpp"
+
+// Colour-mapped frames of a mesh streamed out as video, off the stepping
+// thread.
+//
+// Y4M streams are the `YUV4MPEG2` header then one `FRAME` per push with full
+// resolution 4:4:4 BT.601 planes, which `ffmpeg -i` reads as is. PPM output
+// is one binary `P6` image per frame, numbered from 0 after the path prefix.
+//
+// `push` copies the field into a ring of buffers; worker threads colour-map,
+// upscale and encode whole frames in parallel, and one writer thread puts
+// them out in order, so stepping, encoding and I/O overlap. Unlike snapshots,
+// no frame is ever dropped: `push` waits while every buffer is in flight.
+class FrameWriter {
+   public:
+    enum class Format {
+        Y4m,
+        Ppm,
+    };
+
+    struct Options {
+        Format format = Format::Y4m;
+        // pixels along the side of a cell
+        usize scale = 1;
+        // Y4M only, frames per second of the stream
+        u32 fps = 30;
+        // threads colour-mapping and encoding, 0 uses half the hardware
+        usize workers = 0;
+        usize buffers = 8;
+    };
+
+    struct Stats {
+        usize frames;
+        usize bytes;
+    };
+
+    // Y4M for `-` (stdout) and `.y4m`, numbered PPMs after the prefix
+    // otherwise
+    static Format formatFor(const std::string& path);
+
+    FrameWriter(const std::string& path,
+                const poss::Mesh& mesh,
+                const ColorMap& cmap,
+                const Options& options);
+    ~FrameWriter() { close(); }
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // whether the stream could be opened, and nothing failed to write since
+    [[nodiscard]] bool ok() const;
+
+    // queues the field of `mesh`, laid out like the one the writer was made
+    // for, as the next frame
+    void push(const poss::Mesh& mesh);
+
+    // writes out every pushed frame, then stops the threads
+    void close();
+
+    // totals so far, exact after `close`
+    [[nodiscard]] Stats stats() const;
+
+   private:
+    enum class State : u8 {
+        Free,
+        Filled,
+        Encoded,
+    };
+
+    struct Slot {
+        State state = State::Free;
+        u64 frame = 0;
+        std::vector<float> field;
+        std::vector<u8> bytes;
+    };
+
+    void work();
+    void write();
+    void encode(Slot& slot) const;
+
+    usize width, height;
+    std::string path;
+    Options options;
+    ColorMap cmap;
+    // per cell, whether it is drawn from the colour map or as background
+    std::vector<u8> conducts;
+
+    std::FILE* file = nullptr;
+    bool failed = false;
+
+    // frames are numbered in push order: `head` were pushed, `claimed` taken
+    // by a worker and `tail` written, all guarded by `mutex`
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Slot> slots;
+    u64 head = 0;
+    u64 claimed = 0;
+    u64 tail = 0;
+    usize bytes = 0;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+    std::thread writer;
+};
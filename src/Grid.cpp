@@ -0,0 +1,97 @@
+#include "Grid.hpp"
+
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <utility>
+
+static const char* funnelMap =
+    "###############\n"
+    "fffff#####00000\n"
+    "fffff#####00000\n"
+    "fffff#####00000\n"
+    "fffff7777700000\n"
+    "fffff7777700000\n"
+    "fffff#####00000\n"
+    "fffff#####00000\n"
+    "fffff#####00000\n"
+    "###############\n";
+
+static bool isHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+static u8 fromHex(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return 10 + c - 'a';
+    } else {
+        return 0;
+    }
+}
+
+std::vector<Tile> parseLine(const char* s) {
+    std::vector<Tile> line;
+
+    for (; *s; ++s) {
+        if (*s == '#') {
+            line.push_back(Tile::Insulator());
+        } else if (*s == '+') {
+            line.push_back(Tile::Thermostat(255));
+        } else if (*s == '-') {
+            line.push_back(Tile::Thermostat(0));
+        } else if (isHexDigit(*s)) {
+            line.push_back(Tile::Conductor(fromHex(*s) * 16));
+        }
+    }
+
+    return line;
+}
+
+Grid Grid::funnel() {
+    std::istringstream in(funnelMap);
+    std::optional<Grid> grid = read(in);
+    assert(grid && grid->width() == 15 && grid->height() == 10);
+
+    return std::move(*grid);
+}
+
+std::optional<Grid> Grid::read(std::istream& in) {
+    std::vector<std::vector<Tile>> tiles;
+
+    for (std::string line; std::getline(in, line);) {
+        std::vector<Tile> parsed = parseLine(line.c_str());
+        if (parsed.empty()) {
+            continue;
+        }
+        if (!tiles.empty() && parsed.size() != tiles[0].size()) {
+            return std::nullopt;
+        }
+        tiles.push_back(std::move(parsed));
+    }
+
+    if (tiles.empty()) {
+        return std::nullopt;
+    }
+    return Grid(std::move(tiles));
+}
+
+Grid Grid::repeated(usize across, usize down) const {
+    std::vector<std::vector<Tile>> repeatedTiles;
+    repeatedTiles.reserve(down * tiles.size());
+
+    for (usize _ = 0; _ < down; ++_) {
+        for (const auto& line : tiles) {
+            std::vector<Tile> repeatedLine;
+            repeatedLine.reserve(across * line.size());
+            for (usize __ = 0; __ < across; ++__) {
+                repeatedLine.insert(repeatedLine.end(), line.begin(),
+                                    line.end());
+            }
+            repeatedTiles.push_back(std::move(repeatedLine));
+        }
+    }
+
+    return Grid(std::move(repeatedTiles));
+}
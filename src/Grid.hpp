@@ -0,0 +1,61 @@
+#pragma once
+
+#include <istream>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ints.hpp"
+
+// size in pixels of a grid tile on screen
+static constexpr usize gridSize = 64;
+
+struct Tile {
+    enum class Kind {
+        Insulator,
+        Conductor,
+        // conducts, but is held at its temperature
+        Thermostat,
+    };
+
+    static Tile Thermostat(float temp, u8 conductivity = 0) {
+        return {Kind::Thermostat, temp, conductivity};
+    }
+
+    static Tile Conductor(float temp, u8 conductivity = 0) {
+        return {Kind::Conductor, temp, conductivity};
+    }
+
+    static Tile Insulator() { return {Kind::Insulator, 0, 0}; }
+
+    bool conducts() const { return kind != Kind::Insulator; }
+
+    Kind kind;
+    float temperature;
+    // 0 takes `Mesh::conductivity`
+    u8 conductivity;
+};
+
+std::vector<Tile> parseLine(const char* s);
+
+struct Grid {
+    static Grid funnel();
+
+    // One line of tiles per text line: `#` insulates, a hex digit conducts
+    // at 16 times its value, `+` and `-` are thermostats at 255 and 0. Lines
+    // without tiles are skipped, the others must all be as wide.
+    static std::optional<Grid> read(std::istream& in);
+
+    // `across x down` copies of this layout side by side
+    Grid repeated(usize across, usize down) const;
+
+    Grid(const std::vector<std::vector<Tile>>& t) : tiles(t) {}
+    Grid(std::vector<std::vector<Tile>>&& t) : tiles(std::move(t)) {}
+
+    [[nodiscard]] usize width() const {
+        return tiles.empty() ? 0 : tiles[0].size();
+    }
+    [[nodiscard]] usize height() const { return tiles.size(); }
+
+    std::vector<std::vector<Tile>> tiles;
+};
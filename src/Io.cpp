@@ -0,0 +1,313 @@
+#include "Io.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace io {
+struct LevelHeader {
+    char magic[4];
+    u32 version;
+    u32 width;
+    u32 height;
+};
+
+struct LevelTile {
+    u8 kind;
+    u8 conductivity;
+    u8 reserved[2];
+    float temperature;
+};
+
+static_assert(sizeof(LevelHeader) == 16 && sizeof(LevelTile) == 8);
+
+static constexpr char levelMagic[4] = {'H', 'F', 'L', 'V'};
+static constexpr u32 levelVersion = 1;
+
+// a whole file mapped read-only, empty when it could not be
+class Mapping {
+   public:
+    explicit Mapping(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<usize>(info.st_size),
+                             PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<const u8*>(p);
+                size = static_cast<usize>(info.st_size);
+                ::madvise(p, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~Mapping() {
+        if (data != nullptr) {
+            ::munmap(const_cast<u8*>(data), size);
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    const u8* data = nullptr;
+    usize size = 0;
+};
+
+// the header of a well-formed level, null otherwise
+static const LevelHeader* levelHeader(const Mapping& file) {
+    if (file.size < sizeof(LevelHeader)) {
+        return nullptr;
+    }
+    const auto* header = reinterpret_cast<const LevelHeader*>(file.data);
+    if (std::memcmp(header->magic, levelMagic, sizeof(levelMagic)) != 0 ||
+        header->version != levelVersion || header->width == 0 ||
+        header->height == 0) {
+        return nullptr;
+    }
+
+    // checked by division, the byte count of crafted dimensions can wrap
+    const usize tiles = static_cast<usize>(header->width) * header->height;
+    const usize body = file.size - sizeof(LevelHeader);
+    if (body % sizeof(LevelTile) != 0 || tiles != body / sizeof(LevelTile)) {
+        return nullptr;
+    }
+
+    const auto* records =
+        reinterpret_cast<const LevelTile*>(file.data + sizeof(LevelHeader));
+    for (usize i = 0; i < tiles; ++i) {
+        if (records[i].kind > 2) {
+            return nullptr;
+        }
+    }
+    return header;
+}
+
+// whether the padded planes `Mesh::blank` allocates for a level at
+// `subdivision` have a size that can be represented at all
+static bool meshFits(const LevelHeader& header, usize subdivision) {
+    constexpr usize limit =
+        static_cast<usize>(std::numeric_limits<std::ptrdiff_t>::max()) /
+        sizeof(float);
+    // halo columns and lane padding
+    constexpr usize padding = 2 + cacheLine / sizeof(float);
+    if (header.width > (limit - padding) / subdivision ||
+        header.height > (limit - padding) / subdivision) {
+        return false;
+    }
+    const usize stride = header.width * subdivision + padding;
+    const usize rows = header.height * subdivision + 2;
+    return rows <= limit / stride;
+}
+
+static const LevelTile* levelTiles(const Mapping& file) {
+    return reinterpret_cast<const LevelTile*>(file.data + sizeof(LevelHeader));
+}
+
+// `rows(row)` gives the `width` temperatures of a row
+template <typename Rows>
+static bool writeRawRows(usize width,
+                         usize height,
+                         Rows rows,
+                         const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    for (usize row = 0; row < height; ++row) {
+        file.write(reinterpret_cast<const char*>(rows(row)),
+                   width * sizeof(float));
+    }
+
+    return file.good();
+}
+
+template <typename Rows>
+static bool writePgmRows(usize width,
+                         usize height,
+                         Rows rows,
+                         const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    file << "P5\n" << width << ' ' << height << "\n255\n";
+
+    std::vector<u8> line(width);
+    for (usize row = 0; row < height; ++row) {
+        const float* t = rows(row);
+        for (usize col = 0; col < width; ++col) {
+            line[col] =
+                static_cast<u8>(std::clamp(std::floor(t[col]), 0.0f, 255.0f));
+        }
+        file.write(reinterpret_cast<const char*>(line.data()), line.size());
+    }
+
+    return file.good();
+}
+
+bool writeRaw(const poss::Mesh& mesh, const std::string& path) {
+    return writeRawRows(
+        mesh.width, mesh.height,
+        [&](usize row) { return mesh.temperature.data() + mesh.index(0, row); },
+        path);
+}
+
+bool writePgm(const poss::Mesh& mesh, const std::string& path) {
+    return writePgmRows(
+        mesh.width, mesh.height,
+        [&](usize row) { return mesh.temperature.data() + mesh.index(0, row); },
+        path);
+}
+
+bool writeField(const poss::Mesh& mesh, const std::string& path) {
+    if (path.ends_with(".pgm")) {
+        return writePgm(mesh, path);
+    }
+    return writeRaw(mesh, path);
+}
+
+bool writeField(const PagedMesh& mesh, const std::string& path) {
+    const auto rows = [&](usize row) { return mesh.row(row); };
+    if (path.ends_with(".pgm")) {
+        return writePgmRows(mesh.width(), mesh.height(), rows, path);
+    }
+    return writeRawRows(mesh.width(), mesh.height(), rows, path);
+}
+
+bool writeLevel(const Grid& grid, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    LevelHeader header{};
+    std::memcpy(header.magic, levelMagic, sizeof(levelMagic));
+    header.version = levelVersion;
+    header.width = static_cast<u32>(grid.width());
+    header.height = static_cast<u32>(grid.height());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<LevelTile> line(grid.width());
+    for (const auto& tiles : grid.tiles) {
+        for (usize col = 0; col < tiles.size(); ++col) {
+            line[col] = {};
+            line[col].kind = static_cast<u8>(tiles[col].kind);
+            line[col].conductivity = tiles[col].conductivity;
+            line[col].temperature = tiles[col].temperature;
+        }
+        file.write(reinterpret_cast<const char*>(line.data()),
+                   line.size() * sizeof(LevelTile));
+    }
+
+    return file.good();
+}
+
+std::optional<Grid> readLevel(const std::string& path) {
+    if (!path.ends_with(".hfl")) {
+        std::ifstream file(path);
+        if (!file) {
+            return std::nullopt;
+        }
+        return Grid::read(file);
+    }
+
+    const Mapping file(path);
+    const LevelHeader* header = levelHeader(file);
+    if (header == nullptr) {
+        return std::nullopt;
+    }
+
+    const LevelTile* records = levelTiles(file);
+    std::vector<std::vector<Tile>> tiles(header->height);
+    for (usize row = 0; row < header->height; ++row) {
+        tiles[row].reserve(header->width);
+        for (usize col = 0; col < header->width; ++col) {
+            const LevelTile& r = records[row * header->width + col];
+            tiles[row].push_back(Tile{static_cast<Tile::Kind>(r.kind),
+                                      r.kind == 0 ? 0.0f : r.temperature,
+                                      r.kind == 0 ? u8{0} : r.conductivity});
+        }
+    }
+    return Grid(std::move(tiles));
+}
+
+std::optional<poss::Mesh> mapLevel(const std::string& path,
+                                   usize subdivision) {
+    const Mapping file(path);
+    const LevelHeader* header = levelHeader(file);
+    if (header == nullptr || subdivision == 0 ||
+        !meshFits(*header, subdivision)) {
+        return std::nullopt;
+    }
+
+    const LevelTile* records = levelTiles(file);
+    poss::Mesh mesh = poss::Mesh::blank(subdivision * header->width,
+                                        subdivision * header->height,
+                                        gridSize / subdivision);
+
+    // every tile row becomes `subdivision` identical mesh rows, so only the
+    // first is built from the records and the others are copies of it
+    for (usize row = 0; row < mesh.height; row += subdivision) {
+        const LevelTile* line = records + row / subdivision * header->width;
+        const usize first = mesh.index(0, row);
+        const usize firstThermostat = mesh.thermostats.size();
+
+        for (usize tile = 0; tile < header->width; ++tile) {
+            if (line[tile].kind == 0) {
+                continue;
+            }
+            const usize i = first + tile * subdivision;
+            std::fill_n(&mesh.temperature[i], subdivision,
+                        line[tile].temperature);
+            std::fill_n(&mesh.mask[i], subdivision,
+                        line[tile].kind == 2
+                            ? u8{poss::Mesh::Flag::Conducts |
+                                 poss::Mesh::Flag::Held}
+                            : u8{poss::Mesh::Flag::Conducts});
+            std::fill_n(&mesh.cellConductivity[i], subdivision,
+                        poss::Mesh::tileConductivity(line[tile].conductivity));
+            if (line[tile].kind == 2) {
+                for (usize c = 0; c < subdivision; ++c) {
+                    mesh.thermostats.push_back(i + c);
+                    mesh.setpoints.push_back(line[tile].temperature);
+                }
+            }
+        }
+
+        const usize lastThermostat = mesh.thermostats.size();
+        for (usize copy = 1; copy < subdivision; ++copy) {
+            const usize i = mesh.index(0, row + copy);
+            std::memcpy(&mesh.temperature[i], &mesh.temperature[first],
+                        mesh.width * sizeof(float));
+            std::memcpy(&mesh.mask[i], &mesh.mask[first], mesh.width);
+            std::memcpy(&mesh.cellConductivity[i],
+                        &mesh.cellConductivity[first],
+                        mesh.width * sizeof(float));
+            for (usize t = firstThermostat; t < lastThermostat; ++t) {
+                mesh.thermostats.push_back(mesh.thermostats[t] + i - first);
+                mesh.setpoints.push_back(mesh.setpoints[t]);
+            }
+        }
+    }
+
+    mesh.linkNeighbours();
+    return mesh;
+}
+}  // namespace io
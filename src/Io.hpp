@@ -0,0 +1,38 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "Grid.hpp"
+#include "Mesh.hpp"
+#include "PagedMesh.hpp"
+
+namespace io {
+// `width * height` native-endian float32 temperatures, row-major, insulators
+// included
+bool writeRaw(const poss::Mesh& mesh, const std::string& path);
+
+// 8-bit greyscale image of the temperature field clamped to [0, 255]
+bool writePgm(const poss::Mesh& mesh, const std::string& path);
+
+// picks the format from the extension, `.pgm` or raw otherwise
+bool writeField(const poss::Mesh& mesh, const std::string& path);
+
+// the same for a field stepped out of core, streamed a row at a time
+bool writeField(const PagedMesh& mesh, const std::string& path);
+
+// Binary levels (`.hfl`): a 16 byte header, the magic `HFLV` then version,
+// width and height in tiles as native-endian u32, followed by one 8 byte
+// record per tile, row-major: kind (0 insulator, 1 conductor, 2 thermostat),
+// conductivity (see `Tile::conductivity`), two reserved bytes and the
+// temperature as float32.
+bool writeLevel(const Grid& grid, const std::string& path);
+
+// a binary level when the extension is `.hfl`, a `Grid::read` text map
+// otherwise
+std::optional<Grid> readLevel(const std::string& path);
+
+// Builds the mesh of a binary level straight from a read-only mapping of the
+// file, without going through a `Grid`.
+std::optional<poss::Mesh> mapLevel(const std::string& path, usize subdivision);
+}  // namespace io
@@ -0,0 +1,525 @@
+#include "Kernel.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HEATFLOW_X86 1
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+
+namespace kernel {
+
+static inline float stepCell(const Step& s, usize i) {
+    const u8 m = s.mask[i];
+    const float t = s.src[i];
+
+    if (!(m & Flag::Conducts)) {
+        return t;
+    }
+
+    float sum = 0.0f;
+    float count = 0.0f;
+    sum += (m & Flag::South) ? s.src[i + s.stride] : 0.0f;
+    count += (m & Flag::South) ? 1.0f : 0.0f;
+    sum += (m & Flag::North) ? s.src[i - s.stride] : 0.0f;
+    count += (m & Flag::North) ? 1.0f : 0.0f;
+    sum += (m & Flag::East) ? s.src[i + 1] : 0.0f;
+    count += (m & Flag::East) ? 1.0f : 0.0f;
+    sum += (m & Flag::West) ? s.src[i - 1] : 0.0f;
+    count += (m & Flag::West) ? 1.0f : 0.0f;
+
+    const float laplacian = count == 0.0f ? 0.0f : sum / count - t;
+    return t + s.conductivity * laplacian * s.dt;
+}
+
+// what a conducting cell that went from `t` to `next` adds to a residual
+static inline void measure(Residual& r, u8 m, float t, float next) {
+    if (!(m & Flag::Conducts)) {
+        return;
+    }
+    if (m & Flag::Held) {
+        r.heat += t;
+        return;
+    }
+    const float change = next - t;
+    r.maxChange = std::max(r.maxChange, std::fabs(change));
+    r.sumSquares += static_cast<double>(change) * change;
+    r.heat += next;
+}
+
+template <bool Monitored>
+static Residual runScalar(const Step& s, usize begin, usize end) {
+    Residual r;
+    for (usize i = begin; i < end; ++i) {
+        const float next = stepCell(s, i);
+        s.dst[i] = next;
+        if constexpr (Monitored) {
+            measure(r, s.mask[i], s.src[i], next);
+        }
+    }
+    return r;
+}
+
+static void stepScalar(const Step& s, usize begin, usize end) {
+    runScalar<false>(s, begin, end);
+}
+
+static Residual monitorScalar(const Step& s, usize begin, usize end) {
+    return runScalar<true>(s, begin, end);
+}
+
+#ifdef HEATFLOW_X86
+
+// The monitoring variants keep a running max and double sums per lane, folded
+// together at the end; the step itself is untouched.
+
+// SSE4.1, 4 cells per iteration
+
+__attribute__((target("sse4.1"))) static inline __m128 hasSse(__m128i m,
+                                                              u8 flag) {
+    const __m128i bit = _mm_set1_epi32(flag);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(m, bit), bit));
+}
+
+// adds the four floats of `x` to the two doubles of `sum`
+__attribute__((target("sse4.1"))) static inline __m128d widenSse(__m128d sum,
+                                                                 __m128 x) {
+    return _mm_add_pd(_mm_add_pd(sum, _mm_cvtps_pd(x)),
+                      _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+}
+
+template <bool Monitored>
+__attribute__((target("sse4.1"))) static Residual runSse41(const Step& s,
+                                                           usize begin,
+                                                           usize end) {
+    const __m128 conductivity = _mm_set1_ps(s.conductivity);
+    const __m128 dt = _mm_set1_ps(s.dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 maxChange = zero;
+    __m128d sumSquares = _mm_setzero_pd();
+    __m128d heat = _mm_setzero_pd();
+
+    usize i = begin;
+    for (; i + 4 <= end; i += 4) {
+        i32 packed;
+        std::memcpy(&packed, s.mask + i, sizeof(packed));
+        const __m128i m = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+        const __m128 t = _mm_loadu_ps(s.src + i);
+
+        __m128 sum = zero;
+        __m128 count = zero;
+
+        __m128 has = hasSse(m, Flag::South);
+        sum = _mm_add_ps(sum,
+                         _mm_and_ps(has, _mm_loadu_ps(s.src + i + s.stride)));
+        count = _mm_add_ps(count, _mm_and_ps(has, one));
+        has = hasSse(m, Flag::North);
+        sum = _mm_add_ps(sum,
+                         _mm_and_ps(has, _mm_loadu_ps(s.src + i - s.stride)));
+        count = _mm_add_ps(count, _mm_and_ps(has, one));
+        has = hasSse(m, Flag::East);
+        sum = _mm_add_ps(sum, _mm_and_ps(has, _mm_loadu_ps(s.src + i + 1)));
+        count = _mm_add_ps(count, _mm_and_ps(has, one));
+        has = hasSse(m, Flag::West);
+        sum = _mm_add_ps(sum, _mm_and_ps(has, _mm_loadu_ps(s.src + i - 1)));
+        count = _mm_add_ps(count, _mm_and_ps(has, one));
+
+        // isolated cells divide 0 by 0, the resulting NaN is masked away
+        __m128 laplacian = _mm_sub_ps(_mm_div_ps(sum, count), t);
+        laplacian = _mm_and_ps(laplacian, _mm_cmpneq_ps(count, zero));
+
+        const __m128 next =
+            _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(conductivity, laplacian), dt));
+        const __m128 conducts = hasSse(m, Flag::Conducts);
+        _mm_storeu_ps(s.dst + i, _mm_blendv_ps(t, next, conducts));
+
+        if constexpr (Monitored) {
+            const __m128 held = hasSse(m, Flag::Held);
+            const __m128 change =
+                _mm_andnot_ps(held, _mm_and_ps(conducts, _mm_sub_ps(next, t)));
+            maxChange = _mm_max_ps(
+                maxChange, _mm_andnot_ps(_mm_set1_ps(-0.0f), change));
+            const __m128d lo = _mm_cvtps_pd(change);
+            const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(change, change));
+            sumSquares = _mm_add_pd(
+                sumSquares, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+            heat = widenSse(heat,
+                            _mm_and_ps(conducts, _mm_blendv_ps(next, t, held)));
+        }
+    }
+
+    Residual r = runScalar<Monitored>(s, i, end);
+    if constexpr (Monitored) {
+        alignas(16) float maxLanes[4];
+        alignas(16) double squareLanes[2];
+        alignas(16) double heatLanes[2];
+        _mm_store_ps(maxLanes, maxChange);
+        _mm_store_pd(squareLanes, sumSquares);
+        _mm_store_pd(heatLanes, heat);
+        for (const float lane : maxLanes) {
+            r.maxChange = std::max(r.maxChange, lane);
+        }
+        r.sumSquares += squareLanes[0] + squareLanes[1];
+        r.heat += heatLanes[0] + heatLanes[1];
+    }
+    return r;
+}
+
+__attribute__((target("sse4.1"))) static void stepSse41(const Step& s,
+                                                        usize begin,
+                                                        usize end) {
+    runSse41<false>(s, begin, end);
+}
+
+__attribute__((target("sse4.1"))) static Residual monitorSse41(const Step& s,
+                                                               usize begin,
+                                                               usize end) {
+    return runSse41<true>(s, begin, end);
+}
+
+// AVX2, 8 cells per iteration
+
+__attribute__((target("avx2"))) static inline __m256 hasAvx2(__m256i m,
+                                                             u8 flag) {
+    const __m256i bit = _mm256_set1_epi32(flag);
+    return _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(_mm256_and_si256(m, bit), bit));
+}
+
+// adds the eight floats of `x` to the four doubles of `sum`
+__attribute__((target("avx2"))) static inline __m256d widenAvx2(__m256d sum,
+                                                                __m256 x) {
+    return _mm256_add_pd(
+        _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(x))),
+        _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+}
+
+template <bool Monitored>
+__attribute__((target("avx2"))) static Residual runAvx2(const Step& s,
+                                                        usize begin,
+                                                        usize end) {
+    const __m256 conductivity = _mm256_set1_ps(s.conductivity);
+    const __m256 dt = _mm256_set1_ps(s.dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 maxChange = zero;
+    __m256d sumSquares = _mm256_setzero_pd();
+    __m256d heat = _mm256_setzero_pd();
+
+    usize i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m256i m = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s.mask + i)));
+        const __m256 t = _mm256_loadu_ps(s.src + i);
+
+        __m256 sum = zero;
+        __m256 count = zero;
+
+        __m256 has = hasAvx2(m, Flag::South);
+        sum = _mm256_add_ps(
+            sum, _mm256_and_ps(has, _mm256_loadu_ps(s.src + i + s.stride)));
+        count = _mm256_add_ps(count, _mm256_and_ps(has, one));
+        has = hasAvx2(m, Flag::North);
+        sum = _mm256_add_ps(
+            sum, _mm256_and_ps(has, _mm256_loadu_ps(s.src + i - s.stride)));
+        count = _mm256_add_ps(count, _mm256_and_ps(has, one));
+        has = hasAvx2(m, Flag::East);
+        sum = _mm256_add_ps(sum,
+                            _mm256_and_ps(has, _mm256_loadu_ps(s.src + i + 1)));
+        count = _mm256_add_ps(count, _mm256_and_ps(has, one));
+        has = hasAvx2(m, Flag::West);
+        sum = _mm256_add_ps(sum,
+                            _mm256_and_ps(has, _mm256_loadu_ps(s.src + i - 1)));
+        count = _mm256_add_ps(count, _mm256_and_ps(has, one));
+
+        __m256 laplacian = _mm256_sub_ps(_mm256_div_ps(sum, count), t);
+        laplacian = _mm256_and_ps(laplacian,
+                                  _mm256_cmp_ps(count, zero, _CMP_NEQ_OQ));
+
+        const __m256 next = _mm256_add_ps(
+            t, _mm256_mul_ps(_mm256_mul_ps(conductivity, laplacian), dt));
+        const __m256 conducts = hasAvx2(m, Flag::Conducts);
+        _mm256_storeu_ps(s.dst + i, _mm256_blendv_ps(t, next, conducts));
+
+        if constexpr (Monitored) {
+            const __m256 held = hasAvx2(m, Flag::Held);
+            const __m256 change = _mm256_andnot_ps(
+                held, _mm256_and_ps(conducts, _mm256_sub_ps(next, t)));
+            maxChange = _mm256_max_ps(
+                maxChange, _mm256_andnot_ps(_mm256_set1_ps(-0.0f), change));
+            const __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(change));
+            const __m256d hi =
+                _mm256_cvtps_pd(_mm256_extractf128_ps(change, 1));
+            sumSquares = _mm256_add_pd(
+                sumSquares,
+                _mm256_add_pd(_mm256_mul_pd(lo, lo), _mm256_mul_pd(hi, hi)));
+            heat = widenAvx2(
+                heat, _mm256_and_ps(conducts, _mm256_blendv_ps(next, t, held)));
+        }
+    }
+
+    Residual r = runScalar<Monitored>(s, i, end);
+    if constexpr (Monitored) {
+        alignas(32) float maxLanes[8];
+        alignas(32) double squareLanes[4];
+        alignas(32) double heatLanes[4];
+        _mm256_store_ps(maxLanes, maxChange);
+        _mm256_store_pd(squareLanes, sumSquares);
+        _mm256_store_pd(heatLanes, heat);
+        for (const float lane : maxLanes) {
+            r.maxChange = std::max(r.maxChange, lane);
+        }
+        for (usize lane = 0; lane < 4; ++lane) {
+            r.sumSquares += squareLanes[lane];
+            r.heat += heatLanes[lane];
+        }
+    }
+    return r;
+}
+
+__attribute__((target("avx2"))) static void stepAvx2(const Step& s,
+                                                     usize begin,
+                                                     usize end) {
+    runAvx2<false>(s, begin, end);
+}
+
+__attribute__((target("avx2"))) static Residual monitorAvx2(const Step& s,
+                                                            usize begin,
+                                                            usize end) {
+    return runAvx2<true>(s, begin, end);
+}
+
+// AVX-512, 16 cells per iteration, the tail is handled with a lane mask
+
+__attribute__((target("avx512f"))) static inline __mmask16 hasAvx512(
+    __m512i m,
+    u8 flag) {
+    return _mm512_test_epi32_mask(m, _mm512_set1_epi32(flag));
+}
+
+// Eight of the floats of `x` as doubles, the low half or the high one. The
+// zero-masked forms spare GCC's warnings about the unmasked ones reading
+// undefined registers.
+template <int Half>
+__attribute__((target("avx512f"))) static inline __m512d halfAvx512(__m512 x) {
+    const __m256d half =
+        _mm512_maskz_extractf64x4_pd(0xf, _mm512_castps_pd(x), Half);
+    return _mm512_maskz_cvtps_pd(0xff, _mm256_castpd_ps(half));
+}
+
+// adds the sixteen floats of `x` to the eight doubles of `sum`
+__attribute__((target("avx512f"))) static inline __m512d widenAvx512(
+    __m512d sum,
+    __m512 x) {
+    return _mm512_add_pd(_mm512_add_pd(sum, halfAvx512<0>(x)),
+                         halfAvx512<1>(x));
+}
+
+template <bool Monitored>
+__attribute__((target("avx512f"))) static Residual runAvx512(const Step& s,
+                                                             usize begin,
+                                                             usize end) {
+    const __m512 conductivity = _mm512_set1_ps(s.conductivity);
+    const __m512 dt = _mm512_set1_ps(s.dt);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    __m512 maxChange = zero;
+    __m512d sumSquares = _mm512_setzero_pd();
+    __m512d heat = _mm512_setzero_pd();
+
+    for (usize i = begin; i < end; i += 16) {
+        const usize n = end - i < 16 ? end - i : 16;
+        const __mmask16 lanes = static_cast<__mmask16>((1u << n) - 1);
+
+        __m128i packed;
+        if (n == 16) {
+            packed =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.mask + i));
+        } else {
+            alignas(16) u8 tail[16] = {};
+            std::memcpy(tail, s.mask + i, n);
+            packed = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+        const __m512i m = _mm512_maskz_cvtepu8_epi32(0xffff, packed);
+        const __m512 t = _mm512_maskz_loadu_ps(lanes, s.src + i);
+
+        __m512 sum = zero;
+        __m512 count = zero;
+
+        // only conducting neighbours are loaded, so masked-off lanes never
+        // read past the range
+        __mmask16 has = hasAvx512(m, Flag::South);
+        sum = _mm512_mask_add_ps(
+            sum, has, sum, _mm512_maskz_loadu_ps(has, s.src + i + s.stride));
+        count = _mm512_mask_add_ps(count, has, count, one);
+        has = hasAvx512(m, Flag::North);
+        sum = _mm512_mask_add_ps(
+            sum, has, sum, _mm512_maskz_loadu_ps(has, s.src + i - s.stride));
+        count = _mm512_mask_add_ps(count, has, count, one);
+        has = hasAvx512(m, Flag::East);
+        sum = _mm512_mask_add_ps(sum, has, sum,
+                                 _mm512_maskz_loadu_ps(has, s.src + i + 1));
+        count = _mm512_mask_add_ps(count, has, count, one);
+        has = hasAvx512(m, Flag::West);
+        sum = _mm512_mask_add_ps(sum, has, sum,
+                                 _mm512_maskz_loadu_ps(has, s.src + i - 1));
+        count = _mm512_mask_add_ps(count, has, count, one);
+
+        const __mmask16 connected =
+            _mm512_cmp_ps_mask(count, zero, _CMP_NEQ_OQ);
+        const __m512 laplacian = _mm512_maskz_sub_ps(
+            connected, _mm512_div_ps(sum, count), t);
+
+        const __mmask16 conducts = hasAvx512(m, Flag::Conducts);
+        const __m512 next = _mm512_mask_add_ps(
+            t, conducts, t,
+            _mm512_mul_ps(_mm512_mul_ps(conductivity, laplacian), dt));
+        _mm512_mask_storeu_ps(s.dst + i, lanes, next);
+
+        if constexpr (Monitored) {
+            const __mmask16 held = hasAvx512(m, Flag::Held);
+            const __mmask16 counted = conducts & lanes;
+            const __m512 change =
+                _mm512_maskz_sub_ps(counted & ~held, next, t);
+            maxChange = _mm512_mask_max_ps(maxChange, 0xffff, maxChange,
+                                           _mm512_abs_ps(change));
+            const __m512d lo = halfAvx512<0>(change);
+            const __m512d hi = halfAvx512<1>(change);
+            sumSquares = _mm512_add_pd(
+                sumSquares,
+                _mm512_add_pd(_mm512_mul_pd(lo, lo), _mm512_mul_pd(hi, hi)));
+            const __m512 value = _mm512_mask_blend_ps(held, next, t);
+            heat = widenAvx512(heat, _mm512_maskz_mov_ps(counted, value));
+        }
+    }
+
+    Residual r;
+    if constexpr (Monitored) {
+        alignas(64) float maxLanes[16];
+        alignas(64) double squareLanes[8];
+        alignas(64) double heatLanes[8];
+        _mm512_store_ps(maxLanes, maxChange);
+        _mm512_store_pd(squareLanes, sumSquares);
+        _mm512_store_pd(heatLanes, heat);
+        for (const float lane : maxLanes) {
+            r.maxChange = std::max(r.maxChange, lane);
+        }
+        for (usize lane = 0; lane < 8; ++lane) {
+            r.sumSquares += squareLanes[lane];
+            r.heat += heatLanes[lane];
+        }
+    }
+    return r;
+}
+
+__attribute__((target("avx512f"))) static void stepAvx512(const Step& s,
+                                                          usize begin,
+                                                          usize end) {
+    runAvx512<false>(s, begin, end);
+}
+
+__attribute__((target("avx512f"))) static Residual monitorAvx512(
+    const Step& s,
+    usize begin,
+    usize end) {
+    return runAvx512<true>(s, begin, end);
+}
+
+#endif
+
+const char* name(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return "scalar";
+        case Isa::Sse41:
+            return "sse4.1";
+        case Isa::Avx2:
+            return "avx2";
+        case Isa::Avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+bool supported(Isa isa) {
+#ifdef HEATFLOW_X86
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+        case Isa::Sse41:
+            return __builtin_cpu_supports("sse4.1");
+        case Isa::Avx2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::Avx512:
+            return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+Isa detect() {
+    static const Isa isa = [] {
+        for (Isa candidate : {Isa::Avx512, Isa::Avx2, Isa::Sse41}) {
+            if (supported(candidate)) {
+                return candidate;
+            }
+        }
+        return Isa::Scalar;
+    }();
+    return isa;
+}
+
+StepFn get(Isa isa) {
+#ifdef HEATFLOW_X86
+    switch (isa) {
+        case Isa::Scalar:
+            return stepScalar;
+        case Isa::Sse41:
+            return stepSse41;
+        case Isa::Avx2:
+            return stepAvx2;
+        case Isa::Avx512:
+            return stepAvx512;
+    }
+#endif
+    (void)isa;
+    return stepScalar;
+}
+
+StepFn best() {
+    static const StepFn fn = get(detect());
+    return fn;
+}
+
+MonitorFn getMonitor(Isa isa) {
+#ifdef HEATFLOW_X86
+    switch (isa) {
+        case Isa::Scalar:
+            return monitorScalar;
+        case Isa::Sse41:
+            return monitorSse41;
+        case Isa::Avx2:
+            return monitorAvx2;
+        case Isa::Avx512:
+            return monitorAvx512;
+    }
+#endif
+    (void)isa;
+    return monitorScalar;
+}
+
+MonitorFn bestMonitor() {
+    static const MonitorFn fn = getMonitor(detect());
+    return fn;
+}
+
+}  // namespace kernel
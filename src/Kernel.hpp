@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "ints.hpp"
+
+// Fused Laplacian + forward Euler stencil over the padded planes of a
+// `poss::Mesh`.
+//
+// Every variant performs the same float operations in the same order (no FMA
+// contraction, masked-out neighbours contribute an exact 0.0f), so the SIMD
+// kernels reproduce the scalar kernel bit for bit: the documented tolerance
+// between any two variants is zero ULP.
+namespace kernel {
+
+// Per-cell bits of the mask plane
+enum Flag : u8 {
+    Conducts = 1 << 0,
+    South = 1 << 1,
+    North = 1 << 2,
+    East = 1 << 3,
+    West = 1 << 4,
+    // a thermostat cell, which the stepping kernels treat like any other and
+    // only the monitoring ones leave out of the change
+    Held = 1 << 5,
+};
+
+struct Step {
+    const float* src;
+    float* dst;
+    const u8* mask;
+    usize stride;
+    float conductivity;
+    float dt;
+};
+
+// Dirichlet cells: sorted flat indices and the values they are held at. The
+// kernels step them like any conductor and they are overwritten afterwards,
+// so the stencil loop never tests for them.
+struct Pins {
+    const usize* cells = nullptr;
+    const float* values = nullptr;
+    usize count = 0;
+
+    // re-imposes the pins that fall in `[begin, end)` of `plane`
+    void apply(float* plane, usize begin, usize end) const {
+        const usize* first = std::lower_bound(cells, cells + count, begin);
+        for (const usize* c = first; c != cells + count && *c < end; ++c) {
+            plane[*c] = values[c - cells];
+        }
+    }
+};
+
+// How much a step moved the field, reduced by the monitoring kernels while the
+// cells are still in registers. Changes are taken over the conducting cells
+// that are not `Held`, heat is the sum of the new temperatures of all the
+// conducting ones, with held cells at their value before the step, which is
+// their setpoint unless it was just changed. Results of disjoint ranges
+// `merge`; sums are accumulated in double, per SIMD lane, so their rounding
+// depends on the instruction set and the split but the field never does.
+struct Residual {
+    float maxChange = 0.0f;
+    double sumSquares = 0.0;
+    double heat = 0.0;
+
+    void merge(const Residual& other) {
+        maxChange = std::max(maxChange, other.maxChange);
+        sumSquares += other.sumSquares;
+        heat += other.heat;
+    }
+
+    // L2 norm of the change
+    [[nodiscard]] double norm() const { return std::sqrt(sumSquares); }
+};
+
+// Advances the flat indices `[begin, end)` from `src` into `dst`.
+// Non-conducting cells are copied through, so whole padded rows (halo
+// columns included) can be handed over; the rows directly above and below
+// the range must exist.
+using StepFn = void (*)(const Step& step, usize begin, usize end);
+
+// the same step, writing the same values, that also measures it
+using MonitorFn = Residual (*)(const Step& step, usize begin, usize end);
+
+enum class Isa {
+    Scalar,
+    Sse41,
+    Avx2,
+    Avx512,
+};
+
+[[nodiscard]] const char* name(Isa isa);
+[[nodiscard]] bool supported(Isa isa);
+
+// best instruction set available on this CPU, detected once
+[[nodiscard]] Isa detect();
+
+[[nodiscard]] StepFn get(Isa isa);
+
+// kernel for `detect()`
+[[nodiscard]] StepFn best();
+
+[[nodiscard]] MonitorFn getMonitor(Isa isa);
+[[nodiscard]] MonitorFn bestMonitor();
+
+}  // namespace kernel
@@ -0,0 +1,296 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "Profiler.hpp"
+
+namespace poss {
+float Mesh::tileConductivity(u8 stored) {
+    return stored == 0 ? conductivity : static_cast<float>(stored);
+}
+
+Mesh Mesh::fromGrid(const Grid& grid, usize subdivision) {
+    Mesh mesh = blank(subdivision * grid.width(), subdivision * grid.height(),
+                      gridSize / subdivision);
+
+    for (usize row = 0; row < mesh.height; ++row) {
+        const auto& line = grid.tiles[row / subdivision];
+        for (usize col = 0; col < mesh.width; ++col) {
+            const Tile& tile = line[col / subdivision];
+            if (tile.conducts()) {
+                const usize i = mesh.index(col, row);
+                mesh.temperature[i] = tile.temperature;
+                mesh.mask[i] = Flag::Conducts;
+                mesh.cellConductivity[i] = tileConductivity(tile.conductivity);
+                if (tile.kind == Tile::Kind::Thermostat) {
+                    mesh.mask[i] |= Flag::Held;
+                    mesh.thermostats.push_back(i);
+                    mesh.setpoints.push_back(tile.temperature);
+                }
+            }
+        }
+    }
+
+    mesh.linkNeighbours();
+    return mesh;
+}
+
+Mesh Mesh::blank(usize width, usize height, usize tileSize) {
+    constexpr usize lanes = cacheLine / sizeof(float);
+
+    Mesh mesh;
+    mesh.tileSize = tileSize;
+    mesh.width = width;
+    mesh.height = height;
+    mesh.stride = (mesh.width + 2 + lanes - 1) / lanes * lanes;
+
+    const usize planeSize = (mesh.height + 2) * mesh.stride;
+    mesh.temperature.assign(planeSize, 0.0f);
+    mesh.scratch.assign(planeSize, 0.0f);
+    mesh.mask.assign(planeSize, 0);
+    mesh.cellConductivity.assign(planeSize, 0.0f);
+
+    return mesh;
+}
+
+void Mesh::linkNeighbours() {
+    for (usize row = 0; row < height; ++row) {
+        linkRow(&mask[index(0, row)], width, stride);
+    }
+}
+
+void Mesh::linkRow(u8* m, usize width, usize stride) {
+    // the halo never conducts so neighbours can be read unconditionally, and
+    // rewriting a cell keeps its `Conducts` bit for the next one to read
+    for (usize col = 0; col < width; ++col) {
+        const u8 conducts = m[col] & (Flag::Conducts | Flag::Held);
+        const u8 around =
+            (m[col + stride] & Flag::Conducts ? Flag::South : 0) |
+            (m[col - stride] & Flag::Conducts ? Flag::North : 0) |
+            (m[col + 1] & Flag::Conducts ? Flag::East : 0) |
+            (m[col - 1] & Flag::Conducts ? Flag::West : 0);
+        m[col] = conducts ? conducts | around : 0;
+    }
+}
+
+void Mesh::computeLaplacian() {
+    HEATFLOW_PROFILE_SCOPE(Laplacian);
+    for (usize row = 0; row < height; ++row) {
+        for (usize col = 0; col < width; ++col) {
+            scratch[index(col, row)] = computeLaplacianAt(col, row);
+        }
+    }
+}
+
+kernel::Step Mesh::stepArgs() {
+    return {
+        .src = temperature.data(),
+        .dst = scratch.data(),
+        .mask = mask.data(),
+        .stride = stride,
+        .conductivity = conductivity,
+        .dt = dt,
+    };
+}
+
+void Mesh::update() {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    kernel::best()(stepArgs(), stride, (height + 1) * stride);
+    pins().apply(scratch.data(), 0, scratch.size());
+    std::swap(temperature, scratch);
+}
+
+void Mesh::update(Stepper& stepper, usize steps, kernel::Residual* residual) {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    stepper.run(stepArgs(), height, steps, pins(), residual);
+    if (steps % 2 == 1) {
+        std::swap(temperature, scratch);
+    }
+}
+
+// Rows taking part in a wavefront must stay cache resident: both planes and
+// the mask for `depth + 2` rows.
+static constexpr usize wavefrontBudget = 512 * 1024;
+
+void Mesh::advance(usize steps, kernel::Residual* residual) {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    const kernel::StepFn step = kernel::best();
+    const kernel::MonitorFn monitor = kernel::bestMonitor();
+    if (residual != nullptr) {
+        *residual = {};
+    }
+    const usize rowBytes = stride * (2 * sizeof(float) + sizeof(u8));
+    const usize fit = wavefrontBudget / rowBytes;
+    const usize depth = fit > 3 ? fit - 2 : 1;
+
+    float* planes[2] = {temperature.data(), scratch.data()};
+    kernel::Step args = stepArgs();
+    const kernel::Pins held = pins();
+
+    for (usize done = 0; done < steps;) {
+        const usize block = std::min(depth, steps - done);
+
+        // At wavefront `front`, level `s` computes row `front - s` from time
+        // `done + s` to `done + s + 1`. Its neighbours at time `done + s` were
+        // produced by this front (level s - 1) and the one two fronts back,
+        // and the row it overwrites, time `done + s - 1`, is no longer read.
+        for (usize front = 1; front < height + block; ++front) {
+            for (usize s = 0; s < block; ++s) {
+                if (front < s + 1 || front - s > height) {
+                    continue;
+                }
+                const usize row = front - s;
+                args.src = planes[(done + s) % 2];
+                args.dst = planes[(done + s + 1) % 2];
+                // the level taking the last step
+                if (residual != nullptr && done + s + 1 == steps) {
+                    residual->merge(
+                        monitor(args, row * stride, (row + 1) * stride));
+                } else {
+                    step(args, row * stride, (row + 1) * stride);
+                }
+                held.apply(args.dst, row * stride, (row + 1) * stride);
+            }
+        }
+
+        done += block;
+    }
+
+    if (steps % 2 == 1) {
+        std::swap(temperature, scratch);
+    }
+}
+
+void Mesh::paint(usize col,
+                 usize row,
+                 usize across,
+                 usize down,
+                 const Brush& brush) {
+    using Kind = Brush::Kind;
+    if (col >= width || row >= height || across == 0 || down == 0) {
+        return;
+    }
+    across = std::min(across, width - col);
+    down = std::min(down, height - row);
+
+    const u8 kind = brush.kind == Kind::Insulator ? u8{0}
+                    : brush.kind == Kind::Thermostat
+                        ? u8{Flag::Conducts | Flag::Held}
+                        : u8{Flag::Conducts};
+    const float value = brush.kind == Kind::Insulator ? 0.0f
+                                                       : brush.temperature;
+    const float k = brush.kind == Kind::Insulator ? 0.0f
+                                                  : tileConductivity(0);
+
+    for (usize r = row; r < row + down; ++r) {
+        const usize first = index(col, r);
+        for (usize i = first; i < first + across; ++i) {
+            if (brush.kind == Kind::Temperature) {
+                if (mask[i] & Flag::Conducts) {
+                    temperature[i] = value;
+                }
+                continue;
+            }
+            mask[i] = kind;
+            temperature[i] = value;
+            scratch[i] = value;
+            cellConductivity[i] = k;
+        }
+    }
+
+    // the thermostats from the first cell painted to the last, in order; the
+    // brush's own are the runs from its left column to its right one
+    const usize end = index(col + across, row + down - 1);
+    const usize from = static_cast<usize>(
+        std::ranges::lower_bound(thermostats, index(col, row)) -
+        thermostats.begin());
+    const usize to = static_cast<usize>(
+        std::ranges::lower_bound(thermostats, end) - thermostats.begin());
+
+    if (brush.kind == Kind::Temperature) {
+        for (usize t = from; t < to; ++t) {
+            const usize c = thermostats[t] % stride - 1;
+            if (c >= col && c < col + across) {
+                setpoints[t] = value;
+            }
+        }
+        return;
+    }
+
+    std::vector<usize> cells;
+    std::vector<float> values;
+    usize t = from;
+    for (usize r = row; r < row + down; ++r) {
+        const usize left = index(col, r);
+        for (; t < to && thermostats[t] < left; ++t) {
+            cells.push_back(thermostats[t]);
+            values.push_back(setpoints[t]);
+        }
+        while (t < to && thermostats[t] < left + across) {
+            ++t;
+        }
+        if (brush.kind == Kind::Thermostat) {
+            for (usize i = left; i < left + across; ++i) {
+                cells.push_back(i);
+                values.push_back(value);
+            }
+        }
+    }
+
+    if (cells.size() == to - from) {
+        std::ranges::copy(cells, thermostats.begin() + from);
+        std::ranges::copy(values, setpoints.begin() + from);
+    } else {
+        thermostats.erase(thermostats.begin() + from, thermostats.begin() + to);
+        thermostats.insert(thermostats.begin() + from, cells.begin(),
+                           cells.end());
+        setpoints.erase(setpoints.begin() + from, setpoints.begin() + to);
+        setpoints.insert(setpoints.begin() + from, values.begin(),
+                         values.end());
+    }
+
+    // the brush and the ring around it, which the halo clips
+    const usize left = col == 0 ? 0 : col - 1;
+    const usize right = std::min(col + across + 1, width);
+    const usize top = row == 0 ? 0 : row - 1;
+    const usize bottom = std::min(row + down + 1, height);
+    for (usize r = top; r < bottom; ++r) {
+        linkRow(&mask[index(left, r)], right - left, stride);
+    }
+}
+
+float Mesh::computeLaplacianAt(usize col, usize row) const {
+    const usize i = index(col, row);
+    const u8 m = mask[i];
+
+    if (!(m & Flag::Conducts)) {
+        return -1.0f;
+    }
+
+    usize count = 0;
+    float temperatureSum = 0.0f;
+    if (m & Flag::South) {
+        ++count;
+        temperatureSum += temperature[i + stride];
+    }
+    if (m & Flag::North) {
+        ++count;
+        temperatureSum += temperature[i - stride];
+    }
+    if (m & Flag::East) {
+        ++count;
+        temperatureSum += temperature[i + 1];
+    }
+    if (m & Flag::West) {
+        ++count;
+        temperatureSum += temperature[i - 1];
+    }
+
+    if (count == 0) {
+        return 0.0f;
+    } else {
+        return (temperatureSum / count) - temperature[i];
+    }
+}
+}  // namespace poss
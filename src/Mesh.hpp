@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+
+#include "Grid.hpp"
+#include "Kernel.hpp"
+#include "Stepper.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+namespace poss {
+// Flat, padded storage: every plane is `(height + 2) x stride` with a one cell
+// insulating halo around the domain, so the stencil never needs bounds checks.
+// Rows are padded to a whole number of cache lines.
+struct Mesh {
+    // Per-cell bits in `mask`, computed in `fromGrid` and patched by `paint`
+    using Flag = kernel::Flag;
+
+    static constexpr float conductivity = 10.0f;
+    static constexpr float dt = 0.1f;
+
+    usize width;
+    usize height;
+    usize stride;
+    usize tileSize;
+
+    AlignedVector<float> temperature;
+    AlignedVector<float> scratch;
+    AlignedVector<u8> mask;
+    // per cell, zero for insulators; only `Conduction` reads it, the fused
+    // kernels use the uniform `conductivity`
+    AlignedVector<float> cellConductivity;
+
+    // Thermostat cells, sorted, and what they are held at. Every integrator
+    // re-imposes the setpoints after each step; they may be changed freely
+    // between steps.
+    std::vector<usize> thermostats;
+    std::vector<float> setpoints;
+
+    [[nodiscard]] usize index(usize col, usize row) const {
+        return (row + 1) * stride + (col + 1);
+    }
+
+    [[nodiscard]] bool conducts(usize col, usize row) const {
+        return mask[index(col, row)] & Flag::Conducts;
+    }
+
+    [[nodiscard]] usize cellCount() const { return width * height; }
+
+    static Mesh fromGrid(const Grid& grid, usize subdivision);
+
+    // the conductivity a tile or level record stores as `stored`
+    static float tileConductivity(u8 stored);
+
+    // zeroed planes for `width x height` cells, none of them conducting
+    static Mesh blank(usize width, usize height, usize tileSize);
+
+    // derives the neighbour bits of every cell from the `Conducts` ones
+    void linkNeighbours();
+
+    // the same for the `width` cells from `row` of a mask plane, whose rows
+    // above and below keep their `Conducts` bits; `Held` bits are kept
+    static void linkRow(u8* row, usize width, usize stride);
+
+    // What `paint` puts down
+    struct Brush {
+        enum class Kind {
+            Insulator,
+            Conductor,
+            Thermostat,
+            // only moves the conducting cells, and the setpoints of the held
+            // ones, to `temperature`
+            Temperature,
+        };
+
+        Kind kind;
+        // of the cells painted, insulators are always at 0
+        float temperature = 0.0f;
+    };
+
+    // Paints the `across x down` cells from `col, row`, clipped to the mesh,
+    // between two steps. Only they and the ring around them are rewritten:
+    // kind, temperature in both planes, conductivity, neighbour bits and
+    // setpoints, so the cost is that of the brush, plus one move of the
+    // thermostats after it when their list changes.
+    void paint(usize col,
+               usize row,
+               usize across,
+               usize down,
+               const Brush& brush);
+
+    // leaves the laplacian in `scratch`
+    void computeLaplacian();
+    float computeLaplacianAt(usize col, usize row) const;
+
+    // One fused stencil pass into `scratch`, which then becomes the field.
+    // Given `residual`, the last step also measures how far it moved the
+    // field, see `kernel::Residual`.
+    void update();
+    void update(Stepper& stepper,
+                usize steps,
+                kernel::Residual* residual = nullptr);
+
+    // Same result as `steps` calls to `update`, bit for bit, but temporally
+    // blocked: rows are swept as a wavefront that carries a whole block of
+    // steps, so each row is streamed from memory once per block instead of
+    // once per step.
+    void advance(usize steps, kernel::Residual* residual = nullptr);
+
+    // kernel arguments stepping `temperature` into `scratch`
+    kernel::Step stepArgs();
+
+    [[nodiscard]] kernel::Pins pins() const {
+        return {thermostats.data(), setpoints.data(), thermostats.size()};
+    }
+};
+}  // namespace poss
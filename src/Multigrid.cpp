@@ -0,0 +1,372 @@
+#include "Multigrid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+using Flag = poss::Mesh::Flag;
+
+static constexpr u8 neighbourBits =
+    Flag::South | Flag::North | Flag::East | Flag::West;
+
+static int neighbourCount(u8 m) {
+    return std::popcount(static_cast<u8>(m & neighbourBits));
+}
+
+// sum of the conducting neighbours of `i`
+static float neighbourSum(const float* x, u8 m, usize i, usize stride) {
+    float sum = 0.0f;
+    if (m & Flag::South) {
+        sum += x[i + stride];
+    }
+    if (m & Flag::North) {
+        sum += x[i - stride];
+    }
+    if (m & Flag::East) {
+        sum += x[i + 1];
+    }
+    if (m & Flag::West) {
+        sum += x[i - 1];
+    }
+    return sum;
+}
+
+Multigrid::Multigrid(const Grid& grid, usize subdivision) {
+    for (usize s = subdivision;; s /= 2) {
+        Level level{poss::Mesh::fromGrid(grid, s), {}, {}};
+        level.rhs.assign(level.mesh.temperature.size(), 0.0f);
+        level.fixed.assign(level.mesh.temperature.size(), 0);
+        levels.push_back(std::move(level));
+
+        if (s % 2 != 0) {
+            break;
+        }
+    }
+
+    fineComponents = label(levels.front().mesh);
+    coarseComponents = label(levels.back().mesh);
+}
+
+Multigrid::Report Multigrid::solve(poss::Mesh& mesh,
+                                   std::span<const usize> fixed,
+                                   const Options& options) {
+    Level& fine = levels.front();
+    assert(mesh.width == fine.mesh.width && mesh.height == fine.mesh.height);
+
+    fine.mesh.temperature = mesh.temperature;
+    std::ranges::fill(fine.rhs, 0.0f);
+    for (Level& level : levels) {
+        std::ranges::fill(level.fixed, 0);
+    }
+    for (usize i : fixed) {
+        fine.fixed[i] = 1;
+    }
+    for (usize l = 1; l < levels.size(); ++l) {
+        const Level& child = levels[l - 1];
+        Level& parent = levels[l];
+        for (usize row = 0; row < child.mesh.height; ++row) {
+            for (usize col = 0; col < child.mesh.width; ++col) {
+                if (child.fixed[child.mesh.index(col, row)]) {
+                    parent.fixed[parent.mesh.index(col / 2, row / 2)] = 1;
+                }
+            }
+        }
+    }
+
+    Report report{{residual(fine)}, false};
+    const float initial = report.residuals.front();
+
+    for (usize i = 0; i < options.maxCycles; ++i) {
+        const float previous = report.residuals.back();
+        if (previous <= options.tolerance * initial) {
+            break;
+        }
+        cycle(0, options.smoothing);
+        report.residuals.push_back(residual(fine));
+
+        // float round-off floor, further cycles only shuffle noise around
+        if (report.residuals.back() >= previous) {
+            break;
+        }
+    }
+    report.converged = report.residuals.back() <= options.tolerance * initial;
+
+    conserveHeat(mesh, fine);
+    mesh.temperature = fine.mesh.temperature;
+
+    return report;
+}
+
+void Multigrid::cycle(usize index, usize smoothing) {
+    Level& level = levels[index];
+
+    if (index + 1 == levels.size()) {
+        solveCoarsest(level);
+        return;
+    }
+
+    Level& coarse = levels[index + 1];
+
+    smooth(level, smoothing);
+    residual(level);
+    restrictResidual(level, coarse);
+    std::ranges::fill(coarse.mesh.temperature, 0.0f);
+    cycle(index + 1, smoothing);
+    prolongate(coarse, level);
+    smooth(level, smoothing);
+}
+
+void Multigrid::smooth(Level& level, usize sweeps) const {
+    poss::Mesh& mesh = level.mesh;
+    float* x = mesh.temperature.data();
+
+    for (usize _ = 0; _ < sweeps; ++_) {
+        for (usize colour = 0; colour < 2; ++colour) {
+            for (usize row = 0; row < mesh.height; ++row) {
+                for (usize col = (row + colour) % 2; col < mesh.width;
+                     col += 2) {
+                    const usize i = mesh.index(col, row);
+                    const u8 m = mesh.mask[i];
+                    const int count = neighbourCount(m);
+                    if (!(m & Flag::Conducts) || level.fixed[i] ||
+                        count == 0) {
+                        continue;
+                    }
+                    const float sum = neighbourSum(x, m, i, mesh.stride);
+                    x[i] = (sum - level.rhs[i]) / count;
+                }
+            }
+        }
+    }
+}
+
+float Multigrid::residual(Level& level) const {
+    poss::Mesh& mesh = level.mesh;
+    const float* x = mesh.temperature.data();
+
+    double sum = 0.0;
+    usize free = 0;
+    for (usize row = 0; row < mesh.height; ++row) {
+        for (usize col = 0; col < mesh.width; ++col) {
+            const usize i = mesh.index(col, row);
+            const u8 m = mesh.mask[i];
+            const int count = neighbourCount(m);
+
+            float r = 0.0f;
+            if ((m & Flag::Conducts) && !level.fixed[i] && count != 0) {
+                const float ax =
+                    neighbourSum(x, m, i, mesh.stride) - count * x[i];
+                r = level.rhs[i] - ax;
+                sum += static_cast<double>(r) * r;
+                ++free;
+            }
+            mesh.scratch[i] = r;
+        }
+    }
+
+    return free == 0 ? 0.0f : static_cast<float>(std::sqrt(sum / free));
+}
+
+// the coarse equation of a cell is the sum of its children's: fluxes between
+// siblings cancel and the ones leaving the parent add up
+void Multigrid::restrictResidual(const Level& fine, Level& coarse) const {
+    std::ranges::fill(coarse.rhs, 0.0f);
+
+    for (usize row = 0; row < fine.mesh.height; ++row) {
+        for (usize col = 0; col < fine.mesh.width; ++col) {
+            coarse.rhs[coarse.mesh.index(col / 2, row / 2)] +=
+                fine.mesh.scratch[fine.mesh.index(col, row)];
+        }
+    }
+}
+
+void Multigrid::prolongate(const Level& coarse, Level& fine) const {
+    for (usize row = 0; row < fine.mesh.height; ++row) {
+        for (usize col = 0; col < fine.mesh.width; ++col) {
+            const usize i = fine.mesh.index(col, row);
+            if ((fine.mesh.mask[i] & Flag::Conducts) && !fine.fixed[i]) {
+                fine.mesh.temperature[i] +=
+                    coarse.mesh.temperature[coarse.mesh.index(col / 2,
+                                                              row / 2)];
+            }
+        }
+    }
+}
+
+// Conjugate gradients on `-A`, which is symmetric positive semi-definite over
+// the free cells. Right-hand sides are compatible so the singular directions
+// of insulated components are never excited.
+void Multigrid::solveCoarsest(Level& level) const {
+    poss::Mesh& mesh = level.mesh;
+    float* x = mesh.temperature.data();
+    const usize size = mesh.temperature.size();
+    const usize maxIterations = 4 * (mesh.width + mesh.height);
+
+    const auto isFree = [&](usize i) {
+        const u8 m = mesh.mask[i];
+        return (m & Flag::Conducts) && !level.fixed[i] && neighbourCount(m);
+    };
+
+    makeCompatible(level, level.rhs.data());
+
+    // `residual` leaves b - Ax, the residual of -Ax = -b is its opposite
+    residual(level);
+    std::vector<float> r(size);
+    for (usize i = 0; i < size; ++i) {
+        r[i] = -mesh.scratch[i];
+    }
+    makeCompatible(level, r.data());
+    std::vector<float> p = r;
+    std::vector<float> q(size, 0.0f);
+
+    double rr = 0.0;
+    for (float v : r) {
+        rr += static_cast<double>(v) * v;
+    }
+    const double initial = rr;
+
+    for (usize _ = 0; _ < maxIterations && rr > 1e-12 * initial; ++_) {
+        double pq = 0.0;
+        for (usize row = 0; row < mesh.height; ++row) {
+            for (usize col = 0; col < mesh.width; ++col) {
+                const usize i = mesh.index(col, row);
+                if (!isFree(i)) {
+                    continue;
+                }
+                const u8 m = mesh.mask[i];
+                q[i] = neighbourCount(m) * p[i] -
+                       neighbourSum(p.data(), m, i, mesh.stride);
+                pq += static_cast<double>(p[i]) * q[i];
+            }
+        }
+        if (pq <= 0.0) {
+            break;
+        }
+
+        const float alpha = static_cast<float>(rr / pq);
+        for (usize i = 0; i < size; ++i) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+        makeCompatible(level, r.data());
+
+        double next = 0.0;
+        for (float v : r) {
+            next += static_cast<double>(v) * v;
+        }
+
+        const float beta = static_cast<float>(next / rr);
+        for (usize i = 0; i < size; ++i) {
+            p[i] = r[i] + beta * p[i];
+        }
+        rr = next;
+    }
+}
+
+void Multigrid::conserveHeat(const poss::Mesh& initial, Level& level) const {
+    const poss::Mesh& mesh = level.mesh;
+    const usize n = fineComponents.count;
+
+    std::vector<double> before(n, 0.0);
+    std::vector<double> after(n, 0.0);
+    std::vector<double> weight(n, 0.0);
+    std::vector<bool> anchored(n, false);
+
+    for (usize i = 0; i < mesh.mask.size(); ++i) {
+        if (!(mesh.mask[i] & Flag::Conducts)) {
+            continue;
+        }
+        const u32 c = fineComponents.labels[i];
+        const int count = neighbourCount(mesh.mask[i]);
+        before[c] += count * static_cast<double>(initial.temperature[i]);
+        after[c] += count * static_cast<double>(mesh.temperature[i]);
+        weight[c] += count;
+        anchored[c] = anchored[c] || level.fixed[i];
+    }
+
+    for (usize i = 0; i < mesh.mask.size(); ++i) {
+        if (!(mesh.mask[i] & Flag::Conducts)) {
+            continue;
+        }
+        const u32 c = fineComponents.labels[i];
+        if (!anchored[c] && weight[c] != 0.0) {
+            level.mesh.temperature[i] +=
+                static_cast<float>((before[c] - after[c]) / weight[c]);
+        }
+    }
+}
+
+// Insulated components make the coarse system singular; rounding leaves a
+// small incompatible part in residuals that conjugate gradients would amplify
+// along the constant direction, so it is projected out of `v`.
+void Multigrid::makeCompatible(const Level& level, float* v) const {
+    const poss::Mesh& mesh = level.mesh;
+    const usize n = coarseComponents.count;
+
+    std::vector<double> sum(n, 0.0);
+    std::vector<usize> size(n, 0);
+    std::vector<bool> anchored(n, false);
+
+    for (usize i = 0; i < mesh.mask.size(); ++i) {
+        const u8 m = mesh.mask[i];
+        if (!(m & Flag::Conducts) || neighbourCount(m) == 0) {
+            continue;
+        }
+        const u32 c = coarseComponents.labels[i];
+        anchored[c] = anchored[c] || level.fixed[i];
+        if (!level.fixed[i]) {
+            sum[c] += v[i];
+            ++size[c];
+        }
+    }
+
+    for (usize i = 0; i < mesh.mask.size(); ++i) {
+        const u8 m = mesh.mask[i];
+        if (!(m & Flag::Conducts) || neighbourCount(m) == 0 ||
+            level.fixed[i]) {
+            continue;
+        }
+        const u32 c = coarseComponents.labels[i];
+        if (!anchored[c]) {
+            v[i] -= static_cast<float>(sum[c] / size[c]);
+        }
+    }
+}
+
+Multigrid::Components Multigrid::label(const poss::Mesh& mesh) {
+    constexpr u32 unlabelled = ~u32{0};
+
+    Components components{std::vector<u32>(mesh.mask.size(), unlabelled), 0};
+    std::vector<usize> stack;
+
+    for (usize seed = 0; seed < mesh.mask.size(); ++seed) {
+        if (!(mesh.mask[seed] & Flag::Conducts) ||
+            components.labels[seed] != unlabelled) {
+            continue;
+        }
+
+        const u32 c = components.count++;
+        components.labels[seed] = c;
+        stack.push_back(seed);
+
+        while (!stack.empty()) {
+            const usize i = stack.back();
+            stack.pop_back();
+
+            const u8 m = mesh.mask[i];
+            for (const auto& [bit, n] :
+                 {std::pair{Flag::South, i + mesh.stride},
+                  std::pair{Flag::North, i - mesh.stride},
+                  std::pair{Flag::East, i + 1}, std::pair{Flag::West, i - 1}}) {
+                if ((m & bit) && components.labels[n] == unlabelled) {
+                    components.labels[n] = c;
+                    stack.push_back(n);
+                }
+            }
+        }
+    }
+
+    return components;
+}
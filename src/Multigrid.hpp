@@ -0,0 +1,81 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Geometric multigrid for the equilibrium of the conductor network.
+//
+// Levels are the meshes `Mesh::fromGrid` builds for the subdivision, half of
+// it, and so on while it stays even, so every coarse cell covers exactly four
+// fine cells of the same grid tile and no cell straddles a wall. Each level
+// solves the cell-centred graph Laplacian `sum(x_n - x) = b` with red-black
+// Gauss-Seidel; residuals are summed into the parent cell and corrections are
+// injected back into its four children. The coarsest level is solved with
+// conjugate gradients.
+//
+// Cells listed as fixed keep their temperature (Dirichlet). Components without
+// any fixed cell only have an equilibrium up to a constant, which is chosen
+// to conserve the heat `sum(neighbours * T)` the explicit stepper conserves.
+class Multigrid {
+   public:
+    struct Options {
+        // on the RMS residual relative to the initial one
+        float tolerance = 1e-5f;
+        usize maxCycles = 100;
+        usize smoothing = 2;
+    };
+
+    struct Report {
+        // RMS residual of the fine level, initial one first then one per
+        // V-cycle
+        std::vector<float> residuals;
+        bool converged;
+    };
+
+    Multigrid(const Grid& grid, usize subdivision);
+
+    // `mesh` must have been built from the same grid and subdivision, and
+    // `fixed` holds indices into its planes
+    Report solve(poss::Mesh& mesh,
+                 std::span<const usize> fixed,
+                 const Options& options);
+    Report solve(poss::Mesh& mesh, const Options& options) {
+        return solve(mesh, {}, options);
+    }
+
+    [[nodiscard]] usize levelCount() const { return levels.size(); }
+
+   private:
+    // `mesh.temperature` holds the unknown, `mesh.scratch` the residual
+    struct Level {
+        poss::Mesh mesh;
+        AlignedVector<float> rhs;
+        AlignedVector<u8> fixed;
+    };
+
+    // connected conductors, indexed like the planes
+    struct Components {
+        std::vector<u32> labels;
+        u32 count;
+    };
+
+    static Components label(const poss::Mesh& mesh);
+
+    void cycle(usize level, usize smoothing);
+    void smooth(Level& level, usize sweeps) const;
+    float residual(Level& level) const;
+    void restrictResidual(const Level& fine, Level& coarse) const;
+    void prolongate(const Level& coarse, Level& fine) const;
+    void solveCoarsest(Level& level) const;
+    void makeCompatible(const Level& level, float* v) const;
+    void conserveHeat(const poss::Mesh& initial, Level& level) const;
+
+    std::vector<Level> levels;
+    Components fineComponents;
+    Components coarseComponents;
+};
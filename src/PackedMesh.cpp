@@ -0,0 +1,137 @@
+#include "PackedMesh.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "Kernel.hpp"
+
+using Flag = poss::Mesh::Flag;
+
+// float rows decoded at once by the narrow formats
+static constexpr usize windowBudget = 64 * 1024;
+
+template <typename T>
+PackedMesh<T>::PackedMesh(const poss::Mesh& mesh)
+    : width(mesh.width),
+      height(mesh.height),
+      stride(mesh.stride),
+      temperature(mesh.temperature.size()),
+      scratch(mesh.temperature.size()),
+      mask(mesh.mask),
+      thermostats(mesh.thermostats),
+      stepFn(kernel::best()) {
+    for (usize i = 0; i < temperature.size(); ++i) {
+        temperature[i] = Storage<T>::store(mesh.temperature[i]);
+    }
+    scratch = temperature;
+
+    setpoints.reserve(mesh.setpoints.size());
+    for (float setpoint : mesh.setpoints) {
+        setpoints.push_back(Storage<T>::store(setpoint));
+    }
+}
+
+template <typename T>
+void PackedMesh<T>::update(usize steps) {
+    for (usize _ = 0; _ < steps; ++_) {
+        step();
+        for (usize k = 0; k < thermostats.size(); ++k) {
+            scratch[thermostats[k]] = setpoints[k];
+        }
+        std::swap(temperature, scratch);
+    }
+}
+
+template <typename T>
+void PackedMesh<T>::unpack(poss::Mesh& mesh) const {
+    for (usize i = 0; i < temperature.size(); ++i) {
+        mesh.temperature[i] =
+            static_cast<float>(Storage<T>::load(temperature[i]));
+    }
+}
+
+// Float storage is stepped in place by the fused kernel. Narrow formats go
+// through it too: a block of rows plus the one above and below is decoded
+// into a float window that stays in cache, stepped, and encoded back. Double
+// has no kernel and runs the scalar kernel's operations in double.
+template <typename T>
+void PackedMesh<T>::step() {
+    if constexpr (std::is_same_v<T, float>) {
+        const kernel::Step args = {
+            .src = temperature.data(),
+            .dst = scratch.data(),
+            .mask = mask.data(),
+            .stride = stride,
+            .conductivity = poss::Mesh::conductivity,
+            .dt = poss::Mesh::dt,
+        };
+        stepFn(args, stride, (height + 1) * stride);
+    } else if constexpr (std::is_same_v<T, double>) {
+        const double conductivity = poss::Mesh::conductivity;
+        const double dt = poss::Mesh::dt;
+        const double* src = temperature.data();
+        double* dst = scratch.data();
+
+        for (usize i = stride; i < (height + 1) * stride; ++i) {
+            const u8 m = mask[i];
+            if (!(m & Flag::Conducts)) {
+                dst[i] = src[i];
+                continue;
+            }
+
+            const double t = src[i];
+            double sum = 0.0;
+            double count = 0.0;
+            sum += (m & Flag::South) ? src[i + stride] : 0.0;
+            count += (m & Flag::South) ? 1.0 : 0.0;
+            sum += (m & Flag::North) ? src[i - stride] : 0.0;
+            count += (m & Flag::North) ? 1.0 : 0.0;
+            sum += (m & Flag::East) ? src[i + 1] : 0.0;
+            count += (m & Flag::East) ? 1.0 : 0.0;
+            sum += (m & Flag::West) ? src[i - 1] : 0.0;
+            count += (m & Flag::West) ? 1.0 : 0.0;
+
+            const double laplacian = count == 0.0 ? 0.0 : sum / count - t;
+            dst[i] = t + conductivity * laplacian * dt;
+        }
+    } else {
+        const usize fit = windowBudget / (stride * sizeof(float));
+        const usize block = std::clamp<usize>(fit > 2 ? fit - 2 : 1, 1, height);
+        window.resize((block + 2) * stride);
+        // laid out like the window, so its first row is never written
+        result.resize((block + 1) * stride);
+
+        for (usize first = 1; first <= height; first += block) {
+            const usize rows = std::min(block, height + 1 - first);
+
+            // padded rows `first - 1` to `first + rows`
+            const T* in = temperature.data() + (first - 1) * stride;
+            for (usize j = 0; j < (rows + 2) * stride; ++j) {
+                window[j] = Storage<T>::load(in[j]);
+            }
+
+            // index `stride` of the window is the first row being stepped
+            const kernel::Step args = {
+                .src = window.data(),
+                .dst = result.data(),
+                .mask = mask.data() + (first - 1) * stride,
+                .stride = stride,
+                .conductivity = poss::Mesh::conductivity,
+                .dt = poss::Mesh::dt,
+            };
+            stepFn(args, stride, (rows + 1) * stride);
+
+            T* out = scratch.data() + first * stride;
+            for (usize j = 0; j < rows * stride; ++j) {
+                out[j] = Storage<T>::store(result[stride + j]);
+            }
+        }
+    }
+}
+
+template class PackedMesh<float>;
+template class PackedMesh<double>;
+template class PackedMesh<Half>;
+template class PackedMesh<BFloat16>;
+template class PackedMesh<Fixed16>;
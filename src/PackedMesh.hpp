@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+#include "scalars.hpp"
+
+// The temperature planes of a `poss::Mesh` stored as `T` (see `scalars.hpp`)
+// to cut the bytes moved per cell, stepped with the explicit scheme of
+// `Mesh::update` in `Storage<T>::Accum`: the fused kernels for float and the
+// 16-bit formats, a scalar double loop for the double baseline.
+//
+// Geometry, mask and thermostats are copied from the mesh it was packed from.
+// With float storage the result is bit-identical to `Mesh::update`; narrower
+// formats round every cell on every step, and changes smaller than half a
+// step of the format are lost, which is what `HeatFlowBench` reports against
+// the double baseline.
+template <typename T>
+class PackedMesh {
+   public:
+    using Accum = typename Storage<T>::Accum;
+
+    explicit PackedMesh(const poss::Mesh& mesh);
+
+    void update(usize steps);
+
+    // writes the field back into the mesh it was packed from
+    void unpack(poss::Mesh& mesh) const;
+
+    // temperature in, mask in, temperature out
+    static constexpr usize bytesPerCell = 2 * sizeof(T) + sizeof(u8);
+
+   private:
+    void step();
+
+    usize width, height, stride;
+    AlignedVector<T> temperature;
+    AlignedVector<T> scratch;
+    AlignedVector<u8> mask;
+    std::vector<usize> thermostats;
+    std::vector<T> setpoints;
+
+    kernel::StepFn stepFn;
+    // narrow formats only: decoded rows and their stepped values
+    AlignedVector<float> window;
+    AlignedVector<float> result;
+};
+
+extern template class PackedMesh<float>;
+extern template class PackedMesh<double>;
+extern template class PackedMesh<Half>;
+extern template class PackedMesh<BFloat16>;
+extern template class PackedMesh<Fixed16>;
@@ -0,0 +1,269 @@
+#include "PagedMesh.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "Profiler.hpp"
+#include "aligned.hpp"
+
+using Flag = poss::Mesh::Flag;
+
+// default rows per band, in bytes of all three planes
+static constexpr usize bandBudget = 8 * 1024 * 1024;
+
+static usize physicalMemory() {
+    const long pages = ::sysconf(_SC_PHYS_PAGES);
+    const long pageSize = ::sysconf(_SC_PAGESIZE);
+    return pages > 0 && pageSize > 0
+               ? static_cast<usize>(pages) * static_cast<usize>(pageSize)
+               : usize{1} << 30;
+}
+
+static usize majorFaults() {
+    struct rusage usage;
+    return ::getrusage(RUSAGE_SELF, &usage) == 0
+               ? static_cast<usize>(usage.ru_majflt)
+               : 0;
+}
+
+// bytes the process had read from storage, in the 512 byte blocks the kernel
+// counts
+static usize bytesRead() {
+    struct rusage usage;
+    return ::getrusage(RUSAGE_SELF, &usage) == 0
+               ? static_cast<usize>(usage.ru_inblock) * 512
+               : 0;
+}
+
+PagedMesh::PagedMesh(const Grid& grid,
+                     usize subdivision,
+                     const std::string& path,
+                     const Options& options)
+    : across(subdivision * grid.width()),
+      down(subdivision * grid.height()),
+      page(static_cast<usize>(::sysconf(_SC_PAGESIZE))) {
+    constexpr usize lanes = cacheLine / sizeof(float);
+    stride = (across + 2 + lanes - 1) / lanes * lanes;
+
+    const usize cells = (down + 2) * stride;
+    const auto pages = [&](usize bytes) {
+        return (bytes + page - 1) / page * page;
+    };
+    offsets[0] = 0;
+    offsets[1] = pages(cells * sizeof(float));
+    offsets[2] = offsets[1] + pages(cells * sizeof(float));
+    size = offsets[2] + pages(cells);
+
+    const usize rowBytes = stride * (2 * sizeof(float) + sizeof(u8));
+    const usize resident =
+        options.resident != 0 ? options.resident : physicalMemory() / 2;
+
+    // a quarter of the budget at most, so the two bands around the wavefront
+    // leave it room
+    const usize bandBytes = std::min(bandBudget, resident / 4);
+    band = options.bandRows != 0 ? options.bandRows
+                                 : std::max<usize>(bandBytes / rowBytes, 1);
+    band = std::min(band, down + 2);
+
+    // the wavefront spans depth + 2 rows, with a band prefetched ahead of it
+    // and up to one not yet evicted behind
+    const usize residentRows = resident / rowBytes;
+    evicting = size > resident;
+    sweepDepth = residentRows > 2 * band + 3 ? residentRows - 2 * band - 2 : 1;
+    sweepDepth = std::clamp<usize>(sweepDepth, 1,
+                                   std::max<usize>(options.maxDepth, 1));
+
+    // never an existing file, which the unlink would destroy
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return;
+    }
+    ::unlink(path.c_str());
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        return;
+    }
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return;
+    }
+    base = static_cast<u8*>(p);
+    planes[0] = reinterpret_cast<float*>(base + offsets[0]);
+    planes[1] = reinterpret_cast<float*>(base + offsets[1]);
+    mask = base + offsets[2];
+
+    // The file starts zeroed, which is the halo, every insulator and the
+    // scratch plane. Each tile row is built once and copied down like
+    // `io::mapLevel` does, then the mask is linked in a second pass; both
+    // evict behind themselves like a sweep.
+    usize evictedTo = 0;
+    for (usize tileRow = 0; tileRow < grid.height(); ++tileRow) {
+        const std::vector<Tile>& tiles = grid.tiles[tileRow];
+        const usize first = (tileRow * subdivision + 1) * stride + 1;
+
+        for (usize tile = 0; tile < tiles.size(); ++tile) {
+            if (!tiles[tile].conducts()) {
+                continue;
+            }
+            const usize i = first + tile * subdivision;
+            std::fill_n(planes[0] + i, subdivision, tiles[tile].temperature);
+            const bool held = tiles[tile].kind == Tile::Kind::Thermostat;
+            std::fill_n(mask + i, subdivision,
+                        held ? u8{Flag::Conducts | Flag::Held}
+                             : u8{Flag::Conducts});
+        }
+
+        for (usize copy = 0; copy < subdivision; ++copy) {
+            const usize i = first + copy * stride;
+            if (copy != 0) {
+                std::memcpy(planes[0] + i, planes[0] + first,
+                            across * sizeof(float));
+                std::memcpy(mask + i, mask + first, across);
+            }
+            for (usize tile = 0; tile < tiles.size(); ++tile) {
+                if (tiles[tile].kind == Tile::Kind::Thermostat) {
+                    const usize cell = i + tile * subdivision;
+                    pins.push_back({cell, cell + subdivision,
+                                    tiles[tile].temperature});
+                }
+            }
+        }
+
+        const usize built = (tileRow + 1) * subdivision + 1;
+        while (evicting && evictedTo + band <= built) {
+            evict(evictedTo, evictedTo + band);
+            evictedTo += band;
+        }
+    }
+
+    evictedTo = 0;
+    for (usize row = 0; row < down; ++row) {
+        poss::Mesh::linkRow(mask + (row + 1) * stride + 1, across, stride);
+        while (evicting && evictedTo + band <= row) {
+            evict(evictedTo, evictedTo + band);
+            evictedTo += band;
+        }
+    }
+    if (evicting) {
+        evict(evictedTo, down + 2);
+    }
+}
+
+PagedMesh::~PagedMesh() {
+    if (base != nullptr) {
+        ::munmap(base, size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void PagedMesh::advance(usize steps) {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    const kernel::StepFn step = kernel::best();
+    kernel::Step args = {
+        .src = nullptr,
+        .dst = nullptr,
+        .mask = mask,
+        .stride = stride,
+        .conductivity = poss::Mesh::conductivity,
+        .dt = poss::Mesh::dt,
+    };
+    const usize faults = majorFaults();
+    const usize read = bytesRead();
+
+    for (usize done = 0; done < steps;) {
+        const usize block = std::min(sweepDepth, steps - done);
+        usize fetchedTo = 0;
+        usize evictedTo = 0;
+
+        // the levels of `Mesh::advance`; after front `f` the rows up to
+        // `f - block` are final for this sweep and no longer read
+        for (usize front = 1; front < down + block; ++front) {
+            const usize ahead = std::min(front + 2 + band, down + 2);
+            while (fetchedTo < ahead) {
+                const usize next = std::min(fetchedTo + band, down + 2);
+                totals.advised += prefetch(fetchedTo, next);
+                fetchedTo = next;
+            }
+
+            for (usize s = 0; s < block; ++s) {
+                if (front < s + 1 || front - s > down) {
+                    continue;
+                }
+                const usize row = front - s;
+                args.src = planes[(current + s) % 2];
+                args.dst = planes[(current + s + 1) % 2];
+                step(args, row * stride, (row + 1) * stride);
+                pin(args.dst, row * stride, (row + 1) * stride);
+            }
+
+            while (evicting && front >= block &&
+                   evictedTo + band <= front - block + 1) {
+                totals.evicted += evict(evictedTo, evictedTo + band);
+                evictedTo += band;
+            }
+        }
+        if (evicting) {
+            totals.evicted += evict(evictedTo, down + 2);
+        }
+
+        current = (current + block) % 2;
+        done += block;
+        ++totals.sweeps;
+    }
+
+    totals.majorFaults += majorFaults() - faults;
+    totals.read += bytesRead() - read;
+}
+
+void PagedMesh::pin(float* plane, usize begin, usize end) const {
+    const auto first = std::ranges::upper_bound(pins, begin, {}, &Pin::end);
+    for (auto p = first; p != pins.end() && p->begin < end; ++p) {
+        const usize from = std::max(p->begin, begin);
+        std::fill_n(plane + from, std::min(p->end, end) - from, p->value);
+    }
+}
+
+usize PagedMesh::prefetch(usize first, usize last) {
+    usize bytes = 0;
+    for (usize k = 0; k < 3; ++k) {
+        const usize cell = k < 2 ? sizeof(float) : sizeof(u8);
+        const usize begin = (offsets[k] + first * stride * cell) / page * page;
+        const usize end = std::min(
+            (offsets[k] + last * stride * cell + page - 1) / page * page, size);
+        ::madvise(base + begin, end - begin, MADV_WILLNEED);
+        bytes += end - begin;
+    }
+    return bytes;
+}
+
+// Everything before `first` is done with too, so the range may start on the
+// page holding it; it ends on a page boundary unless it runs to the end of
+// the planes.
+usize PagedMesh::evict(usize first, usize last) {
+    usize bytes = 0;
+    for (usize k = 0; k < 3; ++k) {
+        const usize cell = k < 2 ? sizeof(float) : sizeof(u8);
+        const usize begin = (offsets[k] + first * stride * cell) / page * page;
+        usize end = offsets[k] + last * stride * cell;
+        end = last == down + 2 ? (end + page - 1) / page * page
+                               : end / page * page;
+        if (begin >= end) {
+            continue;
+        }
+        // dirty pages stay in the page cache until written back, which the
+        // second call starts
+        ::madvise(base + begin, end - begin, MADV_DONTNEED);
+        ::posix_fadvise(fd, static_cast<off_t>(begin),
+                        static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+        bytes += end - begin;
+    }
+    return bytes;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Grid.hpp"
+#include "ints.hpp"
+
+// Out-of-core counterpart of `poss::Mesh` for domains larger than memory.
+//
+// The temperature, scratch and mask planes, laid out exactly like the mesh's,
+// live in one file mapped shared, so the kernel pages them in and writes them
+// back instead of the heap holding them. The file must not exist yet and is
+// unlinked as soon as it is created: it is working storage, gone however the
+// run ends.
+//
+// `advance` is the wavefront of `Mesh::advance` with a depth set by how many
+// rows may stay resident rather than by the cache, so each sweep over the file
+// carries up to `maxDepth` steps. Rows are paged in bands: the band ahead of
+// the wavefront is prefetched with `MADV_WILLNEED` and bands it has left
+// behind are dropped from the mapping and handed to writeback, which keeps the
+// resident set bounded and the disk streaming. Results match `Mesh::advance`
+// bit for bit.
+class PagedMesh {
+   public:
+    struct Options {
+        // bytes of the planes that may be resident, 0 for half the physical
+        // memory; when the whole file fits nothing is paged out
+        usize resident = 0;
+        // rows prefetched and evicted at a time, 0 for about 8 MiB of them or
+        // a quarter of `resident` if less
+        usize bandRows = 0;
+        // most steps carried by one sweep over the file
+        usize maxDepth = 64;
+    };
+
+    struct Stats {
+        usize sweeps = 0;
+        // bytes advised in ahead of the wavefront, whether or not they had to
+        // be read, and dropped behind it
+        usize advised = 0;
+        usize evicted = 0;
+        // bytes actually read from storage while stepping
+        usize read = 0;
+        // pages the stepping thread still had to wait for the disk on
+        usize majorFaults = 0;
+    };
+
+    // the layout of `Mesh::fromGrid(grid, subdivision)`, built row by row
+    // into a new file at `path`, which fails if anything is there already
+    PagedMesh(const Grid& grid,
+              usize subdivision,
+              const std::string& path,
+              const Options& options);
+    ~PagedMesh();
+
+    PagedMesh(const PagedMesh&) = delete;
+    PagedMesh& operator=(const PagedMesh&) = delete;
+
+    // whether the file could be created, as a new one, and mapped
+    [[nodiscard]] bool ok() const { return base != nullptr; }
+
+    // same result as `steps` calls to `Mesh::update`
+    void advance(usize steps);
+
+    // the `width` temperatures of a row of the domain
+    [[nodiscard]] const float* row(usize row) const {
+        return planes[current] + (row + 1) * stride + 1;
+    }
+
+    [[nodiscard]] usize width() const { return across; }
+    [[nodiscard]] usize height() const { return down; }
+    [[nodiscard]] usize cellCount() const { return across * down; }
+    [[nodiscard]] usize fileBytes() const { return size; }
+    // steps per sweep and rows per band the options came to
+    [[nodiscard]] usize depth() const { return sweepDepth; }
+    [[nodiscard]] usize bandRows() const { return band; }
+    // whether bands are evicted, that is the file exceeds the budget
+    [[nodiscard]] bool paging() const { return evicting; }
+
+    [[nodiscard]] const Stats& stats() const { return totals; }
+
+   private:
+    // Thermostat cells in runs along a row, sorted: the cells of a thermostat
+    // tile row are consecutive, and one index per cell would not fit beside
+    // billions of them.
+    struct Pin {
+        usize begin;
+        usize end;
+        float value;
+    };
+
+    // re-imposes the pins that fall in `[begin, end)` of `plane`
+    void pin(float* plane, usize begin, usize end) const;
+
+    // applies `advice` to padded rows `[first, last)` of every plane, with
+    // the range rounded out to whole pages when prefetching and in when
+    // evicting; returns the bytes covered
+    usize prefetch(usize first, usize last);
+    usize evict(usize first, usize last);
+
+    usize across, down, stride;
+    usize band;
+    usize sweepDepth;
+    bool evicting;
+
+    int fd = -1;
+    u8* base = nullptr;
+    usize size = 0;
+    usize page;
+    // byte offsets of the planes in the file, each page aligned
+    usize offsets[3];
+
+    float* planes[2] = {nullptr, nullptr};
+    u8* mask = nullptr;
+    // which of `planes` holds the field
+    usize current = 0;
+
+    std::vector<Pin> pins;
+    Stats totals;
+};
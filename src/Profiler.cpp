@@ -0,0 +1,198 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace profile {
+namespace {
+struct Slot {
+    std::atomic<u64> begin{0};
+    std::atomic<u64> end{0};
+    std::atomic<Phase> phase{Phase::Count};
+};
+
+// written by its thread only; `head` counts the spans ever recorded
+struct Ring {
+    u32 thread;
+    std::string name;
+    std::atomic<u64> head{0};
+    std::array<std::atomic<u64>, phaseCount> totals{};
+    std::array<Slot, ringCapacity> slots;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+Registry& registry() {
+    static Registry registry;
+    return registry;
+}
+
+// the first span of a thread registers its ring, later ones take no lock
+Ring& localRing() {
+    thread_local Ring* ring = [] {
+        Registry& r = registry();
+        const std::lock_guard lock(r.mutex);
+        r.rings.push_back(std::make_unique<Ring>());
+        r.rings.back()->thread = static_cast<u32>(r.rings.size());
+        return r.rings.back().get();
+    }();
+    return *ring;
+}
+
+// Calls `fn` on every ring. Rings are never removed, so the pointers can be
+// used after the lock is released.
+template <typename F>
+void forEachRing(F&& fn) {
+    std::vector<Ring*> rings;
+    {
+        Registry& r = registry();
+        const std::lock_guard lock(r.mutex);
+        for (const std::unique_ptr<Ring>& ring : r.rings) {
+            rings.push_back(ring.get());
+        }
+    }
+    for (Ring* ring : rings) {
+        fn(*ring);
+    }
+}
+}  // namespace
+
+const char* name(Phase phase) {
+    switch (phase) {
+        case Phase::Laplacian:
+            return "laplacian";
+        case Phase::Update:
+            return "update";
+        case Phase::Band:
+            return "band";
+        case Phase::Colorize:
+            return "colorize";
+        case Phase::Draw:
+            return "draw";
+        case Phase::Count:
+            break;
+    }
+    return "unknown";
+}
+
+u64 now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void record(Phase phase, u64 begin, u64 end) {
+    Ring& ring = localRing();
+    const u64 head = ring.head.load(std::memory_order_relaxed);
+
+    Slot& slot = ring.slots[head % ringCapacity];
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.phase.store(phase, std::memory_order_relaxed);
+
+    std::atomic<u64>& total = ring.totals[static_cast<usize>(phase)];
+    total.store(total.load(std::memory_order_relaxed) + (end - begin),
+                std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void nameThread(const std::string& name) {
+    if constexpr (enabled) {
+        Ring& ring = localRing();
+        const std::lock_guard lock(registry().mutex);
+        ring.name = name;
+    }
+}
+
+std::array<u64, phaseCount> totals() {
+    std::array<u64, phaseCount> sum{};
+    forEachRing([&](const Ring& ring) {
+        for (usize p = 0; p < phaseCount; ++p) {
+            sum[p] += ring.totals[p].load(std::memory_order_relaxed);
+        }
+    });
+    return sum;
+}
+
+std::vector<Span> spans() {
+    std::vector<Span> out;
+    forEachRing([&](const Ring& ring) {
+        const u64 head = ring.head.load(std::memory_order_acquire);
+        const u64 first = head > ringCapacity ? head - ringCapacity : 0;
+
+        const usize start = out.size();
+        for (u64 i = first; i < head; ++i) {
+            const Slot& slot = ring.slots[i % ringCapacity];
+            out.push_back({slot.begin.load(std::memory_order_relaxed),
+                           slot.end.load(std::memory_order_relaxed),
+                           slot.phase.load(std::memory_order_relaxed),
+                           ring.thread});
+        }
+
+        // the writer may have lapped the copy, and the slot it is writing
+        // now is the one after its head
+        const u64 after = ring.head.load(std::memory_order_acquire);
+        const u64 safe =
+            after + 1 > ringCapacity ? after + 1 - ringCapacity : 0;
+        if (safe > first) {
+            const usize stale = std::min<u64>(safe - first, head - first);
+            out.erase(out.begin() + start, out.begin() + start + stale);
+        }
+    });
+    return out;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    const std::vector<Span> all = spans();
+    u64 origin = ~u64{0};
+    for (const Span& span : all) {
+        origin = std::min(origin, span.begin);
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    const auto separate = [&] {
+        file << (first ? "  " : ",\n  ");
+        first = false;
+    };
+
+    forEachRing([&](const Ring& ring) {
+        separate();
+        std::string name;
+        {
+            const std::lock_guard lock(registry().mutex);
+            name = ring.name.empty() ? "thread " + std::to_string(ring.thread)
+                                     : ring.name;
+        }
+        file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+             << "\"tid\": " << ring.thread << ", \"args\": {\"name\": \""
+             << name << "\"}}";
+    });
+
+    // microseconds, with the nanoseconds kept as decimals
+    file.precision(3);
+    file << std::fixed;
+    for (const Span& span : all) {
+        separate();
+        file << "{\"name\": \"" << profile::name(span.phase)
+             << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << span.thread
+             << ", \"ts\": " << (span.begin - origin) / 1e3
+             << ", \"dur\": " << (span.end - span.begin) / 1e3 << "}";
+    }
+
+    file << "\n]}\n";
+    return file.good();
+}
+}  // namespace profile
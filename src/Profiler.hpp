@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "ints.hpp"
+
+// Scoped timers around the hot paths.
+//
+// `HEATFLOW_PROFILE_SCOPE(Phase)` times the rest of the enclosing block. Each
+// thread appends its spans to its own ring, which only it writes, so
+// recording takes no lock; readers copy the rings while they are being
+// written and drop what may have been overwritten meanwhile. Rings outlive
+// their threads and keep the latest `ringCapacity` spans.
+//
+// Without the `HEATFLOW_PROFILE` definition the macro expands to nothing and
+// the functions below report no spans.
+namespace profile {
+#ifdef HEATFLOW_PROFILE
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+inline constexpr usize ringCapacity = 1 << 14;
+
+enum class Phase : u8 {
+    Laplacian,
+    Update,
+    // one stepper band for one step, on each worker
+    Band,
+    Colorize,
+    Draw,
+    Count,
+};
+
+inline constexpr usize phaseCount = static_cast<usize>(Phase::Count);
+
+const char* name(Phase phase);
+
+// nanoseconds on the steady clock
+u64 now();
+
+struct Span {
+    u64 begin;
+    u64 end;
+    Phase phase;
+    u32 thread;
+};
+
+// appends to the calling thread's ring
+void record(Phase phase, u64 begin, u64 end);
+
+// shown for the calling thread in traces
+void nameThread(const std::string& name);
+
+class Scope {
+   public:
+    explicit Scope(Phase phase) : phase(phase), begin(now()) {}
+    ~Scope() { record(phase, begin, now()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    Phase phase;
+    u64 begin;
+};
+
+// nanoseconds spent in each phase so far, summed over threads
+std::array<u64, phaseCount> totals();
+
+// the spans still in the rings
+std::vector<Span> spans();
+
+// Chrome trace-event JSON of `spans()`, for chrome://tracing or Perfetto
+bool writeChromeTrace(const std::string& path);
+}  // namespace profile
+
+#ifdef HEATFLOW_PROFILE
+#define HEATFLOW_PROFILE_CONCAT_(a, b) a##b
+#define HEATFLOW_PROFILE_CONCAT(a, b) HEATFLOW_PROFILE_CONCAT_(a, b)
+#define HEATFLOW_PROFILE_SCOPE(phase)                                   \
+    const profile::Scope HEATFLOW_PROFILE_CONCAT(profileScope, __LINE__)( \
+        profile::Phase::phase)
+#else
+#define HEATFLOW_PROFILE_SCOPE(phase)
+#endif
@@ -0,0 +1,177 @@
+#include "Renderer.hpp"
+
+#include <span>
+
+static constexpr Color opaqueWhite = {255, 255, 255, 255};
+
+static Texture2D blankTexture(int width, int height) {
+    Image image = GenImageColor(width, height, opaqueWhite);
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+    return texture;
+}
+
+static void drawStretched(Texture2D texture,
+                          float x,
+                          float y,
+                          float w,
+                          float h) {
+    const Rectangle source = {0.0f, 0.0f, static_cast<float>(texture.width),
+                              static_cast<float>(texture.height)};
+    const Rectangle dest = {x, y, w, h};
+    DrawTexturePro(texture, source, dest, {0.0f, 0.0f}, 0.0f, opaqueWhite);
+}
+
+Renderer::Renderer(const poss::Mesh& mesh,
+                   const Look& look,
+                   int scalePanelHeight)
+    : screenWidth(static_cast<int>(mesh.width * mesh.tileSize)),
+      fieldHeight(static_cast<int>(mesh.height * mesh.tileSize)),
+      scalePanelHeight(scalePanelHeight),
+      pixels(mesh.cellCount()),
+      field(blankTexture(mesh.width, mesh.height)) {
+    static constexpr int nSteps = 120;
+
+    std::vector<Rgba> bar(nSteps);
+    for (int i = 0; i < nSteps; ++i) {
+        const float x = static_cast<float>(i) / (nSteps - 1);
+        bar[i] = look.cmap.get(1.0f - x).opaque();
+    }
+    scaleBar = blankTexture(nSteps, 1);
+    UpdateTexture(scaleBar, bar.data());
+}
+
+Renderer::~Renderer() {
+    UnloadTexture(field);
+    UnloadTexture(scaleBar);
+}
+
+void Renderer::colorize(const poss::Mesh& mesh,
+                        const Simulation::Frame& frame,
+                        const Look& look) {
+    const Rgba background = catpuccin::DarkGray.opaque();
+
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        const std::span<Rgba> line(pixels.data() + row * mesh.width,
+                                   mesh.width);
+
+        look.cmap.colorize({frame.temperature.data() + begin, mesh.width},
+                           line, 0.0f, 255.0f);
+        for (usize col = 0; col < mesh.width; ++col) {
+            if (!(frame.mask[begin + col] & poss::Mesh::Flag::Conducts)) {
+                line[col] = background;
+            }
+        }
+    }
+}
+
+void Renderer::render(const poss::Mesh& mesh,
+                      const Simulation::Frame& frame,
+                      const Look& look,
+                      const Cursor* cursor) {
+    {
+        HEATFLOW_PROFILE_SCOPE(Colorize);
+        colorize(mesh, frame, look);
+    }
+    UpdateTexture(field, pixels.data());
+
+    // the buffer swap and frame limiter in `EndDrawing` are not counted
+    {
+        HEATFLOW_PROFILE_SCOPE(Draw);
+        BeginDrawing();
+        ClearBackground(toColor(catpuccin::DarkGray));
+
+        drawStretched(field, 0.0f, 0.0f, screenWidth, fieldHeight);
+        drawStretched(scaleBar, 0.0f, fieldHeight, screenWidth,
+                      scalePanelHeight);
+
+        if (cursor != nullptr) {
+            drawCursor(mesh, *cursor);
+        }
+        if (look.displayFps) {
+            drawOverlay(mesh, frame, cursor);
+        }
+    }
+    EndDrawing();
+}
+
+static const char* brushName(poss::Mesh::Brush::Kind kind) {
+    using Kind = poss::Mesh::Brush::Kind;
+    switch (kind) {
+        case Kind::Insulator:
+            return "insulator";
+        case Kind::Conductor:
+            return "conductor";
+        case Kind::Thermostat:
+            return "thermostat";
+        case Kind::Temperature:
+            return "temperature";
+    }
+    return "";
+}
+
+void Renderer::drawCursor(const poss::Mesh& mesh, const Cursor& cursor) {
+    const float cell = static_cast<float>(screenWidth) / mesh.width;
+    const Rectangle outline = {cursor.col * cell, cursor.row * cell,
+                               cursor.size * cell, cursor.size * cell};
+    DrawRectangleLinesEx(outline, 2.0f, toColor(catpuccin::Green));
+}
+
+void Renderer::drawOverlay(const poss::Mesh& mesh,
+                           const Simulation::Frame& frame,
+                           const Cursor* cursor) {
+    constexpr int fontSize = 20;
+    const Color color = toColor(catpuccin::Green);
+
+    // the solver's rate next to the render loop's, which no longer match
+    const double cellUpdates =
+        static_cast<double>(frame.stepsPerSecond) * mesh.cellCount();
+    DrawText(TextFormat("%.0f steps/s  %.3g cell-updates/s  %d fps",
+                        frame.stepsPerSecond, cellUpdates, GetFPS()),
+             4, 4, fontSize, color);
+    int y = 4 + fontSize;
+
+    if (frame.monitored) {
+        DrawText(TextFormat("change %.2e max  %.2e l2  heat %.4e%s",
+                            frame.residual.maxChange, frame.residual.norm(),
+                            frame.residual.heat, frame.idle ? "  idle" : ""),
+                 4, y, fontSize, color);
+        y += fontSize;
+    }
+
+    if (cursor != nullptr) {
+        const char* name = brushName(cursor->brush.kind);
+        if (cursor->brush.kind == poss::Mesh::Brush::Kind::Insulator) {
+            DrawText(TextFormat("brush %s %zux%zu", name, cursor->size,
+                                cursor->size),
+                     4, y, fontSize, color);
+        } else {
+            DrawText(TextFormat("brush %s %zux%zu at %.0f", name,
+                                cursor->size, cursor->size,
+                                cursor->brush.temperature),
+                     4, y, fontSize, color);
+        }
+        y += fontSize;
+    }
+
+    if constexpr (profile::enabled) {
+        // bands run on every worker at once, so their sum is not frame time
+        constexpr float smoothing = 0.05f;
+        const std::array<u64, profile::phaseCount> totals = profile::totals();
+        for (usize p = 0; p < profile::phaseCount; ++p) {
+            const float ms = (totals[p] - lastTotals[p]) / 1e6f;
+            msPerFrame[p] += smoothing * (ms - msPerFrame[p]);
+
+            const auto phase = static_cast<profile::Phase>(p);
+            if (phase != profile::Phase::Band) {
+                DrawText(TextFormat("%-10s %6.2f ms/frame",
+                                    profile::name(phase), msPerFrame[p]),
+                         4, y, fontSize, color);
+                y += fontSize;
+            }
+        }
+        lastTotals = totals;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <raylib.h>
+#include <array>
+#include <vector>
+
+#include "ColorMap.hpp"
+#include "Mesh.hpp"
+#include "Profiler.hpp"
+#include "Rgb.hpp"
+#include "Simulation.hpp"
+
+static constexpr Color toColor(Rgb rgb) {
+    const Rgba c = rgb.opaque();
+    return {c.red, c.green, c.blue, c.alpha};
+}
+
+struct Look {
+    ColorMap cmap;
+    bool displayFps;
+};
+
+// the paint brush under the mouse, outlined over the field
+struct Cursor {
+    usize col, row;
+    usize size;
+    poss::Mesh::Brush brush;
+};
+
+// Draws a mesh as one texture: a published temperature plane is colour-mapped
+// into a CPU pixel buffer, uploaded once per frame and stretched with nearest
+// filtering, so the draw cost does not depend on the cell count. The scale
+// bar is baked once into its own texture.
+//
+// The overlay shows the solver's rate, the brush and, in profiling builds, the
+// rolling time per frame of each profiled phase.
+//
+// Needs a live window, and must be destroyed before it is closed.
+class Renderer {
+   public:
+    Renderer(const poss::Mesh& mesh, const Look& look, int scalePanelHeight);
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // `frame` holds the temperatures and the mask, `mesh` only the geometry;
+    // `cursor` is drawn when there is one
+    void render(const poss::Mesh& mesh,
+                const Simulation::Frame& frame,
+                const Look& look,
+                const Cursor* cursor = nullptr);
+
+   private:
+    void colorize(const poss::Mesh& mesh,
+                  const Simulation::Frame& frame,
+                  const Look& look);
+    void drawCursor(const poss::Mesh& mesh, const Cursor& cursor);
+    void drawOverlay(const poss::Mesh& mesh,
+                     const Simulation::Frame& frame,
+                     const Cursor* cursor);
+
+    int screenWidth;
+    int fieldHeight;
+    int scalePanelHeight;
+
+    std::vector<Rgba> pixels;
+    Texture2D field;
+    Texture2D scaleBar;
+
+    // phase totals at the last frame, and their smoothed per-frame deltas
+    std::array<u64, profile::phaseCount> lastTotals{};
+    std::array<float, profile::phaseCount> msPerFrame{};
+};
@@ -1,9 +1,15 @@
 #pragma once
 
-#include <raylib.h>
-
 #include "ints.hpp"
 
+// same layout as raylib's `Color`, so pixel buffers can be uploaded as is
+struct Rgba {
+    u8 red;
+    u8 green;
+    u8 blue;
+    u8 alpha;
+};
+
 struct Rgb {
     u8 red;
     u8 green;
@@ -19,11 +25,11 @@ struct Rgb {
         return {r, g, b};
     }
 
-    [[nodiscard]] constexpr Color withAlpha(u8 alpha) const {
+    [[nodiscard]] constexpr Rgba withAlpha(u8 alpha) const {
         return {red, green, blue, alpha};
     }
 
-    [[nodiscard]] constexpr Color opaque() const {
+    [[nodiscard]] constexpr Rgba opaque() const {
         return this->withAlpha(0xff);
     }
 };
@@ -0,0 +1,161 @@
+#include "Simulation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "Profiler.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// how long steps are counted before the rate shown is refreshed
+static constexpr auto rateWindow = std::chrono::milliseconds(500);
+
+Simulation::Simulation(poss::Mesh& mesh,
+                       Stepper& stepper,
+                       const Options& options)
+    : mesh(mesh),
+      stepper(stepper),
+      stepsPerFrame(options.stepsPerFrame),
+      tolerance(options.tolerance),
+      idlePeriod(options.idlePeriod),
+      frames(Frame{.temperature = mesh.temperature, .mask = mesh.mask}),
+      targetRate(options.rate) {
+    assert(options.stepsPerFrame != 0);
+    thread = std::thread([this] { work(); });
+}
+
+Simulation::~Simulation() {
+    {
+        const std::lock_guard lock(strokeMutex);
+        stopping.store(true, std::memory_order_relaxed);
+    }
+    stroked.notify_one();
+    thread.join();
+}
+
+const Simulation::Frame& Simulation::latest() {
+    frames.take();
+    return frames.front();
+}
+
+void Simulation::setRate(float rate) {
+    targetRate.store(rate, std::memory_order_relaxed);
+}
+
+void Simulation::paint(usize col,
+                       usize row,
+                       usize across,
+                       usize down,
+                       const poss::Mesh::Brush& brush) {
+    {
+        const std::lock_guard lock(strokeMutex);
+        strokes.push_back({col, row, across, down, brush});
+    }
+    stroked.notify_one();
+}
+
+bool Simulation::applyStrokes() {
+    {
+        const std::lock_guard lock(strokeMutex);
+        std::swap(strokes, applying);
+    }
+    if (applying.empty()) {
+        return false;
+    }
+    for (const Stroke& s : applying) {
+        mesh.paint(s.col, s.row, s.across, s.down, s.brush);
+        if (s.brush.kind != poss::Mesh::Brush::Kind::Temperature) {
+            ++layout;
+        }
+    }
+    applying.clear();
+    return true;
+}
+
+void Simulation::work() {
+    profile::nameThread("solver");
+    u64 step = 0;
+    float stepsPerSecond = 0.0f;
+
+    // steps are paced against the time since the rate last changed
+    float rate = -1.0f;
+    Clock::time_point paceStart;
+    u64 paced = 0;
+
+    Clock::time_point windowStart = Clock::now();
+    u64 windowSteps = 0;
+
+    const bool monitored = tolerance > 0.0f;
+    kernel::Residual residual;
+    bool idle = false;
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        usize chunk = stepsPerFrame;
+
+        if (idle) {
+            std::unique_lock lock(strokeMutex);
+            stroked.wait_for(lock, idlePeriod, [&] {
+                return !strokes.empty() ||
+                       stopping.load(std::memory_order_relaxed);
+            });
+            // pacing starts over once the field moves again
+            rate = -1.0f;
+        }
+        // an edit moves the field, so an idle solver steps right away
+        if (applyStrokes()) {
+            idle = false;
+        }
+
+        const float target = targetRate.load(std::memory_order_relaxed);
+        if (!idle && target != rate) {
+            rate = target;
+            paceStart = Clock::now();
+            paced = 0;
+        }
+        if (!idle && rate > 0.0f) {
+            const double stepsPerWallSecond = rate / poss::Mesh::dt;
+            const double elapsed =
+                std::chrono::duration<double>(Clock::now() - paceStart)
+                    .count();
+            const u64 due = static_cast<u64>(elapsed * stepsPerWallSecond);
+            if (due <= paced) {
+                const std::chrono::duration<double> next(
+                    (paced + 1) / stepsPerWallSecond);
+                std::this_thread::sleep_until(
+                    paceStart +
+                    std::chrono::duration_cast<Clock::duration>(next));
+                continue;
+            }
+            chunk = std::min<u64>(chunk, due - paced);
+        }
+
+        mesh.update(stepper, chunk, monitored ? &residual : nullptr);
+        idle = monitored && residual.maxChange < tolerance;
+        step += chunk;
+        paced += chunk;
+        windowSteps += chunk;
+
+        const Clock::time_point now = Clock::now();
+        if (now - windowStart >= rateWindow) {
+            stepsPerSecond = static_cast<float>(
+                windowSteps /
+                std::chrono::duration<double>(now - windowStart).count());
+            windowStart = now;
+            windowSteps = 0;
+        }
+
+        Frame& frame = frames.back();
+        std::ranges::copy(mesh.temperature, frame.temperature.begin());
+        if (frame.layout != layout) {
+            std::ranges::copy(mesh.mask, frame.mask.begin());
+            frame.layout = layout;
+        }
+        frame.step = step;
+        frame.stepsPerSecond = stepsPerSecond;
+        frame.monitored = monitored;
+        frame.residual = residual;
+        frame.idle = idle;
+        frames.publish();
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "Stepper.hpp"
+#include "TripleBuffer.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Steps a mesh on its own thread and publishes its temperature plane through
+// a triple buffer, so a slow frame never holds up the solver and a slow step
+// never holds up drawing.
+//
+// The mesh and stepper belong to the solver thread until the simulation is
+// destroyed; readers only get the published frames. Edits are queued with
+// `paint` and applied by the solver between two chunks of steps, so painting
+// never stops it. The geometry never changes; the mask is published along
+// with the field, and only copied into a frame when it was painted since.
+class Simulation {
+   public:
+    struct Options {
+        // simulated time per wall-clock second, 0 steps as fast as possible
+        float rate = 0.0f;
+        // most steps between two published frames
+        usize stepsPerFrame = 25;
+        // Once a chunk's last step moves no cell by this many degrees or
+        // more, the solver idles: a chunk every `idlePeriod`, whatever the
+        // rate, until a step moves the field again. 0 never idles and skips
+        // the monitoring.
+        float tolerance = 0.0f;
+        std::chrono::milliseconds idlePeriod{250};
+    };
+
+    struct Frame {
+        // padded like `Mesh::temperature` and `Mesh::mask`
+        AlignedVector<float> temperature;
+        AlignedVector<u8> mask;
+        // bumped by every edit to the layout
+        u64 layout = 0;
+        u64 step = 0;
+        // over the last half second or so
+        float stepsPerSecond = 0.0f;
+        // whether the solver measures its steps, a positive tolerance
+        bool monitored = false;
+        // of the last step published, when monitored
+        kernel::Residual residual = {};
+        bool idle = false;
+    };
+
+    Simulation(poss::Mesh& mesh, Stepper& stepper, const Options& options);
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // the latest published frame, never blocks; only for one reader thread
+    [[nodiscard]] const Frame& latest();
+
+    // takes effect from the next chunk of steps
+    void setRate(float rate);
+    [[nodiscard]] float rate() const {
+        return targetRate.load(std::memory_order_relaxed);
+    }
+
+    // `Mesh::paint`, applied before the next chunk; wakes an idle solver
+    void paint(usize col,
+               usize row,
+               usize across,
+               usize down,
+               const poss::Mesh::Brush& brush);
+
+   private:
+    struct Stroke {
+        usize col, row;
+        usize across, down;
+        poss::Mesh::Brush brush;
+    };
+
+    void work();
+    // applies the strokes queued so far, returns whether there were any
+    bool applyStrokes();
+
+    poss::Mesh& mesh;
+    Stepper& stepper;
+    const usize stepsPerFrame;
+    const float tolerance;
+    const std::chrono::milliseconds idlePeriod;
+
+    TripleBuffer<Frame> frames;
+    std::atomic<float> targetRate;
+    std::atomic<bool> stopping{false};
+
+    // queued by `paint`, guarded by `strokeMutex`, which also lets an idle
+    // solver sleep until one comes
+    std::mutex strokeMutex;
+    std::condition_variable stroked;
+    std::vector<Stroke> strokes;
+    std::vector<Stroke> applying;
+    u64 layout = 0;
+
+    std::thread thread;
+};
@@ -0,0 +1,337 @@
+#include "Snapshots.hpp"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+struct SeriesHeader {
+    char magic[4];
+    u32 version;
+    u32 width;
+    u32 height;
+};
+
+struct ChunkHeader {
+    u64 step;
+    u32 keyframe;
+    u32 size;
+    u32 checksum;
+    u32 reserved;
+};
+
+static_assert(sizeof(SeriesHeader) == 16 && sizeof(ChunkHeader) == 24);
+
+static constexpr char seriesMagic[4] = {'H', 'F', 'T', 'S'};
+static constexpr u32 seriesVersion = 1;
+
+static u32 fnv1a(const u8* data, usize size) {
+    u32 hash = 2166136261u;
+    for (usize i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// PackBits: a control byte `c < 128` is followed by `c + 1` literal bytes,
+// `c > 128` by one byte repeated `257 - c` times
+static void packBits(const u8* in, usize size, std::vector<u8>& out) {
+    out.clear();
+
+    for (usize i = 0; i < size;) {
+        usize run = 1;
+        while (i + run < size && run < 128 && in[i + run] == in[i]) {
+            ++run;
+        }
+        if (run >= 2) {
+            out.push_back(static_cast<u8>(257 - run));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+
+        const usize start = i;
+        while (i < size && i - start < 128 &&
+               !(i + 1 < size && in[i + 1] == in[i])) {
+            ++i;
+        }
+        out.push_back(static_cast<u8>(i - start - 1));
+        out.insert(out.end(), in + start, in + i);
+    }
+}
+
+static bool unpackBits(const u8* in, usize size, u8* out, usize expected) {
+    usize o = 0;
+
+    for (usize i = 0; i < size;) {
+        const u8 c = in[i++];
+        if (c < 128) {
+            const usize count = c + 1;
+            if (i + count > size || o + count > expected) {
+                return false;
+            }
+            std::memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        } else if (c > 128) {
+            const usize count = 257 - c;
+            if (i >= size || o + count > expected) {
+                return false;
+            }
+            std::memset(out + o, in[i++], count);
+            o += count;
+        }
+    }
+
+    return o == expected;
+}
+
+// Walks the chunks of an open series, positioned after its header, and
+// returns the offset just past the last intact one. With `frame`, every chunk
+// is decoded into it and `step` receives the last one's step.
+static long scanChunks(std::FILE* file,
+                       usize cells,
+                       std::vector<u32>* frame,
+                       u64* step) {
+    std::vector<u8> payload;
+    std::vector<u8> planes(cells * sizeof(u32));
+    long end = std::ftell(file);
+
+    while (true) {
+        ChunkHeader chunk;
+        if (std::fread(&chunk, sizeof(chunk), 1, file) != 1) {
+            break;
+        }
+        payload.resize(chunk.size);
+        if (std::fread(payload.data(), 1, chunk.size, file) != chunk.size ||
+            fnv1a(payload.data(), chunk.size) != chunk.checksum) {
+            break;
+        }
+
+        if (frame != nullptr) {
+            if (!unpackBits(payload.data(), chunk.size, planes.data(),
+                            planes.size())) {
+                break;
+            }
+            for (usize j = 0; j < cells; ++j) {
+                u32 x = 0;
+                for (usize k = 0; k < sizeof(u32); ++k) {
+                    x |= static_cast<u32>(planes[k * cells + j]) << (8 * k);
+                }
+                (*frame)[j] = chunk.keyframe ? x : (*frame)[j] ^ x;
+            }
+            *step = chunk.step;
+        }
+        end = std::ftell(file);
+    }
+
+    return end;
+}
+
+// opens a series for reading and checks its header against the mesh
+static std::FILE* openSeries(const std::string& path,
+                             const poss::Mesh& mesh,
+                             const char* mode) {
+    std::FILE* file = std::fopen(path.c_str(), mode);
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    SeriesHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, seriesMagic, sizeof(seriesMagic)) != 0 ||
+        header.version != seriesVersion || header.width != mesh.width ||
+        header.height != mesh.height) {
+        std::fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path,
+                               const poss::Mesh& mesh,
+                               const Options& options)
+    : width(mesh.width),
+      height(mesh.height),
+      keyframeInterval(options.keyframeInterval == 0
+                           ? 1
+                           : options.keyframeInterval) {
+    if (options.append && std::filesystem::exists(path)) {
+        // drop whatever a crash left after the last intact chunk
+        file = openSeries(path, mesh, "rb");
+        if (file == nullptr) {
+            return;
+        }
+        const long end = scanChunks(file, width * height, nullptr, nullptr);
+        std::fclose(file);
+        std::error_code error;
+        std::filesystem::resize_file(path, static_cast<usize>(end), error);
+        file = error ? nullptr : std::fopen(path.c_str(), "ab");
+    } else {
+        file = std::fopen(path.c_str(), "wb");
+        if (file != nullptr) {
+            SeriesHeader header{};
+            std::memcpy(header.magic, seriesMagic, sizeof(seriesMagic));
+            header.version = seriesVersion;
+            header.width = static_cast<u32>(width);
+            header.height = static_cast<u32>(height);
+            if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+    }
+    if (file == nullptr) {
+        failed.store(true, std::memory_order_release);
+        return;
+    }
+
+    const usize cells = width * height;
+    ring.resize(options.buffers == 0 ? 1 : options.buffers);
+    for (Buffer& buffer : ring) {
+        buffer.field.resize(cells);
+    }
+    previous.assign(cells, 0);
+    planes.resize(cells * sizeof(u32));
+
+    writer = std::thread([this] { this->work(); });
+}
+
+void SnapshotWriter::close() {
+    if (writer.joinable()) {
+        stopping.store(true, std::memory_order_release);
+        wake.fetch_add(1, std::memory_order_release);
+        wake.notify_one();
+        writer.join();
+    }
+    if (file != nullptr) {
+        if (std::fclose(file) != 0) {
+            failed.store(true, std::memory_order_release);
+        }
+        file = nullptr;
+    }
+}
+
+bool SnapshotWriter::push(const poss::Mesh& mesh, u64 step, bool wait) {
+    if (file == nullptr) {
+        return false;
+    }
+
+    const u64 h = head.load(std::memory_order_relaxed);
+    for (u64 t = tail.load(std::memory_order_acquire); h - t == ring.size();
+         t = tail.load(std::memory_order_acquire)) {
+        if (!wait) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        tail.wait(t, std::memory_order_acquire);
+    }
+
+    Buffer& buffer = ring[h % ring.size()];
+    buffer.step = step;
+    for (usize row = 0; row < height; ++row) {
+        std::memcpy(buffer.field.data() + row * width,
+                    mesh.temperature.data() + mesh.index(0, row),
+                    width * sizeof(float));
+    }
+
+    head.store(h + 1, std::memory_order_release);
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
+    return true;
+}
+
+SnapshotWriter::Stats SnapshotWriter::stats() const {
+    return {
+        written.load(std::memory_order_acquire),
+        dropped.load(std::memory_order_relaxed),
+        bytes.load(std::memory_order_relaxed),
+        failed.load(std::memory_order_acquire),
+    };
+}
+
+void SnapshotWriter::work() {
+    while (true) {
+        // read before looking at `head`, so a push in between is not missed
+        const u32 seen = wake.load(std::memory_order_acquire);
+        const u64 t = tail.load(std::memory_order_relaxed);
+
+        if (head.load(std::memory_order_acquire) == t) {
+            if (stopping.load(std::memory_order_acquire)) {
+                return;
+            }
+            wake.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+
+        write(ring[t % ring.size()]);
+        tail.store(t + 1, std::memory_order_release);
+        tail.notify_one();
+    }
+}
+
+void SnapshotWriter::write(const Buffer& buffer) {
+    // a later chunk would be a delta against one that is not in the file
+    if (failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    const usize cells = width * height;
+    const bool keyframe = sinceKeyframe == 0;
+
+    for (usize j = 0; j < cells; ++j) {
+        const u32 bits = std::bit_cast<u32>(buffer.field[j]);
+        const u32 x = keyframe ? bits : bits ^ previous[j];
+        previous[j] = bits;
+        for (usize k = 0; k < sizeof(u32); ++k) {
+            planes[k * cells + j] = static_cast<u8>(x >> (8 * k));
+        }
+    }
+    packBits(planes.data(), planes.size(), encoded);
+
+    ChunkHeader chunk{};
+    chunk.step = buffer.step;
+    chunk.keyframe = keyframe;
+    chunk.size = static_cast<u32>(encoded.size());
+    chunk.checksum = fnv1a(encoded.data(), encoded.size());
+
+    // a crash loses at most the chunk being written
+    const bool complete =
+        std::fwrite(&chunk, sizeof(chunk), 1, file) == 1 &&
+        std::fwrite(encoded.data(), 1, encoded.size(), file) ==
+            encoded.size() &&
+        std::fflush(file) == 0;
+    if (!complete) {
+        failed.store(true, std::memory_order_release);
+        return;
+    }
+
+    bytes.fetch_add(sizeof(chunk) + encoded.size(), std::memory_order_relaxed);
+    written.fetch_add(1, std::memory_order_release);
+    sinceKeyframe = (sinceKeyframe + 1) % keyframeInterval;
+}
+
+std::optional<u64> resumeSnapshot(const std::string& path, poss::Mesh& mesh) {
+    std::FILE* file = openSeries(path, mesh, "rb");
+    if (file == nullptr) {
+        return std::nullopt;
+    }
+
+    const usize cells = mesh.width * mesh.height;
+    std::vector<u32> frame(cells, 0);
+    std::optional<u64> step;
+    u64 last = 0;
+    const long header = std::ftell(file);
+    if (scanChunks(file, cells, &frame, &last) != header) {
+        step = last;
+    }
+    std::fclose(file);
+
+    if (step) {
+        for (usize row = 0; row < mesh.height; ++row) {
+            std::memcpy(mesh.temperature.data() + mesh.index(0, row),
+                        frame.data() + row * mesh.width,
+                        mesh.width * sizeof(float));
+        }
+    }
+    return step;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "ints.hpp"
+
+// Time series of temperature fields, written off the stepping thread.
+//
+// A series file is a 16 byte header, the magic `HFTS` then version, width and
+// height as native-endian u32, followed by one chunk per frame: the step as
+// u64, a keyframe flag, the encoded size and an FNV-1a checksum of the
+// payload as u32s, a reserved u32, then the payload. Each payload is the
+// frame's float bits XORed with the previous frame's (with nothing for
+// keyframes), regrouped into four byte planes and PackBits compressed, so the
+// slowly changing high bytes collapse into runs.
+//
+// Files double as checkpoints: `resumeSnapshot` decodes up to the last intact
+// chunk and a writer opened with `append` continues after it.
+class SnapshotWriter {
+   public:
+    struct Options {
+        // frames that can be in flight before `push` starts dropping
+        usize buffers = 4;
+        usize keyframeInterval = 64;
+        // continue an existing series instead of starting a new one
+        bool append = false;
+    };
+
+    struct Stats {
+        usize written;
+        usize dropped;
+        usize bytes;
+        // a chunk, or closing the file, failed and the series stops there
+        bool failed;
+    };
+
+    SnapshotWriter(const std::string& path,
+                   const poss::Mesh& mesh,
+                   const Options& options);
+    ~SnapshotWriter() { close(); }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // whether the file could be opened, and appended to, and nothing failed
+    // to write since
+    [[nodiscard]] bool ok() const {
+        return !failed.load(std::memory_order_acquire);
+    }
+
+    // Copies the field into a free buffer for the writer thread. Unless
+    // `wait`, for instance on the last frame of a run, it never blocks: when
+    // every buffer is still queued the frame is dropped and false returned.
+    bool push(const poss::Mesh& mesh, u64 step, bool wait = false);
+
+    // writes out every pushed frame, then stops the writer
+    void close();
+
+    // totals so far, exact after `close`
+    [[nodiscard]] Stats stats() const;
+
+   private:
+    struct Buffer {
+        u64 step;
+        std::vector<float> field;
+    };
+
+    void work();
+    void write(const Buffer& buffer);
+
+    usize width, height;
+    usize keyframeInterval;
+    std::FILE* file = nullptr;
+
+    // single producer, single consumer: `head` counts pushed buffers and
+    // `tail` written ones
+    std::vector<Buffer> ring;
+    std::atomic<u64> head{0};
+    std::atomic<u64> tail{0};
+    // bumped on every push so the writer can park until there is work
+    std::atomic<u32> wake{0};
+    std::atomic<bool> stopping{false};
+
+    // set by the writer thread, or by `close`
+    std::atomic<bool> failed{false};
+
+    // writer thread only
+    std::vector<u32> previous;
+    std::vector<u8> planes;
+    std::vector<u8> encoded;
+    usize sinceKeyframe = 0;
+
+    std::atomic<usize> written{0};
+    std::atomic<usize> dropped{0};
+    std::atomic<usize> bytes{0};
+    std::thread writer;
+};
+
+// Loads the last intact frame of the series at `path` into `mesh` and returns
+// its step, or nothing when the file is missing, does not match the mesh or
+// holds no frame.
+std::optional<u64> resumeSnapshot(const std::string& path, poss::Mesh& mesh);
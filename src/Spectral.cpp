@@ -0,0 +1,347 @@
+#include "Spectral.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "Kernel.hpp"
+#include "Profiler.hpp"
+
+using Flag = poss::Mesh::Flag;
+
+// the largest rectangle of open cells, by the histogram of open cells above
+// each one; zero sized when none is open
+static Spectral::Region largestOpen(const std::vector<u8>& open,
+                                    usize width,
+                                    usize height) {
+    Spectral::Region best = {0, 0, 0, 0, false};
+    std::vector<usize> above(width, 0);
+    std::vector<usize> stack;
+
+    for (usize row = 0; row < height; ++row) {
+        for (usize col = 0; col < width; ++col) {
+            above[col] = open[row * width + col] ? above[col] + 1 : 0;
+        }
+        stack.clear();
+        for (usize col = 0; col <= width; ++col) {
+            const usize tall = col < width ? above[col] : 0;
+            while (!stack.empty() && above[stack.back()] >= tall) {
+                const usize top = above[stack.back()];
+                stack.pop_back();
+                const usize left = stack.empty() ? 0 : stack.back() + 1;
+                if (top * (col - left) > best.width * best.height) {
+                    best = {left, row + 1 - top, col - left, top, false};
+                }
+            }
+            stack.push_back(col);
+        }
+    }
+    return best;
+}
+
+// the largest length up to `n` made of 2, 3 and 5 only, which the FFT takes in
+// its fast radices
+static usize smoothBelow(usize n) {
+    for (;; --n) {
+        usize left = n;
+        for (usize p : {2, 3, 5}) {
+            while (left % p == 0) {
+                left /= p;
+            }
+        }
+        if (left == 1) {
+            return n;
+        }
+    }
+}
+
+static std::vector<double> laplacianModes(usize n) {
+    std::vector<double> modes(n);
+    for (usize k = 0; k < n; ++k) {
+        modes[k] = 2.0 - 2.0 * std::cos(std::numbers::pi * k / n);
+    }
+    return modes;
+}
+
+Spectral::Spectral(const poss::Mesh& mesh, const Options& options) {
+    const usize width = mesh.width;
+    const usize height = mesh.height;
+
+    std::vector<u8> open(width * height, 0);
+    for (usize row = 0; row < height; ++row) {
+        for (usize col = 0; col < width; ++col) {
+            open[row * width + col] = mesh.conducts(col, row);
+        }
+    }
+    for (usize i : mesh.thermostats) {
+        const usize row = i / mesh.stride - 1;
+        const usize col = i % mesh.stride - 1;
+        open[row * width + col] = 0;
+    }
+
+    const auto touches = [&](usize first, usize step, usize count) {
+        for (usize i = 0; i < count; ++i) {
+            if (mesh.mask[first + i * step] & Flag::Conducts) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const usize margin = options.margin;
+    const usize minSide = std::max<usize>(options.minSide, 1);
+    while (true) {
+        Region r = largestOpen(open, width, height);
+        if (std::min(r.width, r.height) < minSide) {
+            break;
+        }
+        for (usize row = r.row; row < r.row + r.height; ++row) {
+            std::fill_n(open.begin() + row * width + r.col, r.width, u8{0});
+        }
+
+        // the halo makes the cells past the domain insulators
+        const usize stride = mesh.stride;
+        const usize corner = mesh.index(r.col, r.row);
+        const bool west = touches(corner - 1, stride, r.height);
+        const bool east = touches(corner + r.width, stride, r.height);
+        const bool north = touches(corner - stride, 1, r.width);
+        const bool south = touches(corner + r.height * stride, 1, r.width);
+        const usize across = (west ? margin : 0) + (east ? margin : 0);
+        const usize down = (north ? margin : 0) + (south ? margin : 0);
+        if (r.width < across + minSide || r.height < down + minSide) {
+            continue;
+        }
+        r.col += west ? margin : 0;
+        r.row += north ? margin : 0;
+        r.width -= across;
+        r.height -= down;
+
+        // a side that is stencil cells anyway may give up a few more to make
+        // the length quick to transform
+        if (west || east) {
+            const usize trim = r.width - smoothBelow(r.width);
+            r.col += east ? 0 : trim;
+            r.width -= trim;
+        }
+        if (north || south) {
+            const usize trim = r.height - smoothBelow(r.height);
+            r.row += south ? 0 : trim;
+            r.height -= trim;
+        }
+
+        Block block = {
+            .region = r,
+            .across = Dct(r.width),
+            .down = Dct(r.height),
+            .acrossModes = laplacianModes(r.width),
+            .downModes = laplacianModes(r.height),
+            .faces = {},
+            .inflow = {},
+        };
+        const auto face = [&](usize col, usize row, usize outside) {
+            const usize cell = mesh.index(r.col + col, r.row + row);
+            if (mesh.mask[outside] & Flag::Conducts) {
+                block.faces.push_back({outside, cell, row * r.width + col});
+            }
+        };
+        for (usize row = 0; row < r.height; ++row) {
+            const usize first = mesh.index(r.col, r.row + row);
+            face(0, row, first - 1);
+            face(r.width - 1, row, first + r.width);
+        }
+        for (usize col = 0; col < r.width; ++col) {
+            const usize first = mesh.index(r.col + col, r.row);
+            face(col, 0, first - stride);
+            face(col, r.height - 1, first + r.height * stride);
+        }
+        block.region.closed = block.faces.empty();
+        block.inflow.assign(block.faces.size(), 0.0);
+        blocks.push_back(std::move(block));
+    }
+
+    // runs of the conductors left out of the blocks; insulators hold the
+    // same value in both planes, so the stencil need not copy them through
+    std::vector<u8> inBlock(mesh.mask.size(), 0);
+    for (const Block& block : blocks) {
+        const Region& r = block.region;
+        for (usize row = r.row; row < r.row + r.height; ++row) {
+            const usize first = mesh.index(r.col, row);
+            std::fill_n(inBlock.begin() + first, r.width, u8{1});
+        }
+    }
+    for (usize row = 0; row < height; ++row) {
+        const usize end = mesh.index(width, row);
+        for (usize i = mesh.index(0, row); i < end; ++i) {
+            const bool stepped =
+                (mesh.mask[i] & Flag::Conducts) && !inBlock[i];
+            if (!stepped) {
+                continue;
+            }
+            if (!spans.empty() && spans.back().end == i) {
+                ++spans.back().end;
+            } else {
+                spans.push_back({i, i + 1});
+            }
+        }
+    }
+    const bool coupled = std::ranges::any_of(
+        blocks, [](const Block& block) { return !block.faces.empty(); });
+
+    // heat diffuses across the buffer in about margin^2 / (conductivity / 4)
+    if (coupled) {
+        maxPass = std::max<usize>(
+            static_cast<usize>(margin * margin /
+                               (poss::Mesh::conductivity * poss::Mesh::dt)),
+            1);
+    }
+}
+
+void Spectral::advance(poss::Mesh& mesh, usize steps) {
+    HEATFLOW_PROFILE_SCOPE(Update);
+    for (usize done = 0; done < steps;) {
+        const usize block =
+            maxPass == 0 ? steps - done : std::min(maxPass, steps - done);
+        pass(mesh, block);
+        done += block;
+    }
+}
+
+std::vector<Spectral::Region> Spectral::regions() const {
+    std::vector<Region> out;
+    for (const Block& block : blocks) {
+        out.push_back(block.region);
+    }
+    return out;
+}
+
+usize Spectral::spectralCells() const {
+    usize cells = 0;
+    for (const Block& block : blocks) {
+        cells += block.region.width * block.region.height;
+    }
+    return cells;
+}
+
+void Spectral::pass(poss::Mesh& mesh, usize steps) {
+    if (!spans.empty()) {
+        // the stencil reads the blocks from both planes, frozen for the pass
+        for (const Block& block : blocks) {
+            const Region& r = block.region;
+            for (usize row = r.row; row < r.row + r.height; ++row) {
+                const usize first = mesh.index(r.col, row);
+                std::copy_n(mesh.temperature.begin() + first, r.width,
+                            mesh.scratch.begin() + first);
+            }
+        }
+
+        const kernel::StepFn step = kernel::best();
+        const kernel::Pins pins = mesh.pins();
+        kernel::Step args = mesh.stepArgs();
+        float* planes[2] = {mesh.temperature.data(), mesh.scratch.data()};
+        const double face = 0.25 * mesh.conductivity * mesh.dt;
+
+        for (usize s = 0; s < steps; ++s) {
+            args.src = planes[s % 2];
+            args.dst = planes[(s + 1) % 2];
+            for (const Span& span : spans) {
+                step(args, span.begin, span.end);
+                pins.apply(args.dst, span.begin, span.end);
+            }
+            for (Block& block : blocks) {
+                for (usize f = 0; f < block.faces.size(); ++f) {
+                    const Face& at = block.faces[f];
+                    block.inflow[f] +=
+                        face * (args.src[at.outside] - args.src[at.cell]);
+                }
+            }
+        }
+        if (steps % 2 == 1) {
+            std::swap(mesh.temperature, mesh.scratch);
+        }
+    }
+
+    const double time = static_cast<double>(mesh.dt) * steps;
+    for (Block& block : blocks) {
+        propagate(mesh, block, time);
+    }
+    ++passes;
+}
+
+// Rows and columns go through the transforms two at a time.
+void Spectral::propagate(poss::Mesh& mesh, Block& block, double time) {
+    const Region& r = block.region;
+    const usize w = r.width;
+    const usize h = r.height;
+    field.resize(w * h);
+    columns.resize(2 * h);
+
+    for (usize row = 0; row < h; ++row) {
+        const usize first = mesh.index(r.col, r.row + row);
+        std::copy_n(mesh.temperature.begin() + first, w,
+                    field.begin() + row * w);
+    }
+    for (usize f = 0; f < block.faces.size(); ++f) {
+        field[block.faces[f].local] += block.inflow[f];
+        block.inflow[f] = 0.0;
+    }
+
+    const auto alongRows = [&](auto transform) {
+        usize row = 0;
+        for (; row + 1 < h; row += 2) {
+            transform(block.across, field.data() + row * w,
+                      field.data() + (row + 1) * w);
+        }
+        if (row < h) {
+            transform(block.across, field.data() + row * w, nullptr);
+        }
+    };
+    const auto alongColumns = [&](auto transform) {
+        for (usize col = 0; col < w; col += 2) {
+            const bool pair = col + 1 < w;
+            for (usize row = 0; row < h; ++row) {
+                columns[row] = field[row * w + col];
+                columns[h + row] = pair ? field[row * w + col + 1] : 0.0;
+            }
+            transform(block.down, columns.data(),
+                      pair ? columns.data() + h : nullptr);
+            for (usize row = 0; row < h; ++row) {
+                field[row * w + col] = columns[row];
+                if (pair) {
+                    field[row * w + col + 1] = columns[h + row];
+                }
+            }
+        }
+    };
+    const auto forward = [](Dct& dct, double* x, double* y) {
+        y != nullptr ? dct.forward(x, y) : dct.forward(x);
+    };
+    const auto inverse = [](Dct& dct, double* x, double* y) {
+        y != nullptr ? dct.inverse(x, y) : dct.inverse(x);
+    };
+
+    alongRows(forward);
+    alongColumns(forward);
+
+    // the modes are separable, so is their decay
+    const double rate = 0.25 * mesh.conductivity * time;
+    decay.resize(w);
+    for (usize col = 0; col < w; ++col) {
+        decay[col] = std::exp(-rate * block.acrossModes[col]);
+    }
+    for (usize row = 0; row < h; ++row) {
+        const double down = std::exp(-rate * block.downModes[row]);
+        for (usize col = 0; col < w; ++col) {
+            field[row * w + col] *= down * decay[col];
+        }
+    }
+
+    alongColumns(inverse);
+    alongRows(inverse);
+
+    for (usize row = 0; row < h; ++row) {
+        const usize first = mesh.index(r.col, r.row + row);
+        std::transform(field.begin() + row * w, field.begin() + (row + 1) * w,
+                       mesh.temperature.begin() + first,
+                       [](double t) { return static_cast<float>(t); });
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+
+#include "Dct.hpp"
+#include "Mesh.hpp"
+#include "ints.hpp"
+
+// Exact propagator for the homogeneous rectangles of a mesh, with the explicit
+// stencil of `Mesh::update` for everything else.
+//
+// A rectangle of conductors with no thermostat in it follows
+// `dT/dt = conductivity / 4 * L T`, L the five-point Laplacian with insulated
+// walls, which the 2D `Dct` diagonalises. A pass of any length is one forward
+// transform, each mode scaled by `exp(-conductivity / 4 * t * (lx + ly))` with
+// `lx`, `ly` its eigenvalues along the two axes, and one inverse transform, so
+// its cost does not grow with the time it covers. Inside a rectangle this is
+// the operator of `Mesh::update`; along its walls `update` takes the mean of
+// fewer neighbours and moves those cells up to 4/3 faster, which changes how
+// fast the rectangle settles but not where it settles.
+//
+// Rectangles are taken greedily, largest first. A closed one, every wall an
+// insulator, takes any pass in one go, and a mesh that is a single such
+// rectangle is propagated whole. Where a rectangle touches other conductors,
+// `margin` cells along that side are left to the stencil as a buffer, and a
+// pass is cut into stencil steps over the cells outside the rectangles. These
+// read the rectangle as it was when the pass began; the heat crossing each of
+// its faces, at the interior face coefficient, is summed over the steps and
+// put into the rectangle's edge cells before it is propagated. The lag makes
+// the coupling first order in the pass length, and keeps it stable while the
+// pass is short against the time heat takes to cross the buffer, which bounds
+// `passSteps`.
+class Spectral {
+   public:
+    struct Options {
+        // rectangles narrower than this are left to the stencil
+        usize minSide = 32;
+        // stencil cells between a rectangle and the conductors it touches
+        usize margin = 16;
+    };
+
+    struct Region {
+        // the cells propagated spectrally
+        usize col, row;
+        usize width, height;
+        // no conductor touches it, so it has no faces to couple
+        bool closed;
+    };
+
+    Spectral(const poss::Mesh& mesh, const Options& options);
+
+    // the time of `steps` calls to `Mesh::update`, in passes of up to
+    // `passSteps`
+    void advance(poss::Mesh& mesh, usize steps);
+
+    [[nodiscard]] std::vector<Region> regions() const;
+    [[nodiscard]] usize spectralCells() const;
+    // most steps carried by a pass, 0 when every rectangle is closed and a
+    // pass may be as long as asked
+    [[nodiscard]] usize passSteps() const { return maxPass; }
+    [[nodiscard]] usize passCount() const { return passes; }
+
+   private:
+    struct Face {
+        // the conductor outside and the edge cell inside, in the mesh planes
+        usize outside;
+        usize cell;
+        // and the edge cell in the block's field
+        usize local;
+    };
+
+    struct Block {
+        Region region;
+        Dct across;
+        Dct down;
+        // eigenvalues of the Laplacian along each axis
+        std::vector<double> acrossModes;
+        std::vector<double> downModes;
+        std::vector<Face> faces;
+        // heat the faces brought in during the current pass
+        std::vector<double> inflow;
+    };
+
+    // the padded flat range of a row the stencil steps
+    struct Span {
+        usize begin;
+        usize end;
+    };
+
+    void pass(poss::Mesh& mesh, usize steps);
+    void propagate(poss::Mesh& mesh, Block& block, double time);
+
+    std::vector<Block> blocks;
+    std::vector<Span> spans;
+    usize maxPass = 0;
+    usize passes = 0;
+
+    // a block's field, two of its columns and the decay along its rows
+    std::vector<double> field;
+    std::vector<double> columns;
+    std::vector<double> decay;
+};
@@ -0,0 +1,113 @@
+#include "Stepper.hpp"
+
+#include <string>
+#include <utility>
+
+#include "Profiler.hpp"
+
+static usize resolveThreads(usize threads) {
+    if (threads != 0) {
+        return threads;
+    }
+    const usize hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+Stepper::Stepper(usize threads)
+    : nThreads(resolveThreads(threads)),
+      kernel(kernel::best()),
+      monitor(kernel::bestMonitor()),
+      partials(nThreads),
+      barrier(nThreads) {
+    workers.reserve(nThreads - 1);
+    for (usize worker = 1; worker < nThreads; ++worker) {
+        workers.emplace_back([this, worker] { this->work(worker); });
+    }
+}
+
+Stepper::~Stepper() {
+    stopping.store(true, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void Stepper::run(const kernel::Step& step,
+                  usize rows,
+                  usize steps,
+                  const kernel::Pins& pins,
+                  kernel::Residual* residual) {
+    if (steps == 0) {
+        return;
+    }
+
+    job = {step, rows, steps, pins, residual != nullptr};
+    if (nThreads > 1) {
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+    }
+
+    runBand(0);
+
+    // the last barrier has opened, so every band's partial is in
+    if (residual != nullptr) {
+        *residual = {};
+        for (const Partial& partial : partials) {
+            residual->merge(partial.residual);
+        }
+    }
+}
+
+void Stepper::work(usize worker) {
+    profile::nameThread("worker " + std::to_string(worker));
+    u32 seen = 0;
+
+    while (true) {
+        generation.wait(seen, std::memory_order_acquire);
+        seen = generation.load(std::memory_order_acquire);
+
+        if (stopping.load(std::memory_order_relaxed)) {
+            return;
+        }
+        runBand(worker);
+    }
+}
+
+void Stepper::runBand(usize worker) {
+    // `job` may be overwritten by the next `run` as soon as the last barrier
+    // opens, so it is only read up front
+    const Job local = job;
+    const usize rowBegin = 1 + local.rows * worker / nThreads;
+    const usize rowEnd = 1 + local.rows * (worker + 1) / nThreads;
+
+    kernel::Step step = local.step;
+    const usize begin = rowBegin * step.stride;
+    const usize end = rowEnd * step.stride;
+
+    // both planes belong to the mesh and take turns being written
+    float* src = const_cast<float*>(step.src);
+    float* dst = step.dst;
+
+    for (usize i = 0; i < local.steps; ++i) {
+        {
+            HEATFLOW_PROFILE_SCOPE(Band);
+            step.src = src;
+            step.dst = dst;
+            if (local.monitored && i + 1 == local.steps) {
+                partials[worker].residual = monitor(step, begin, end);
+            } else {
+                kernel(step, begin, end);
+            }
+            local.pins.apply(dst, begin, end);
+        }
+        std::swap(src, dst);
+
+        // nobody may read the next source before every band has written it
+        if (nThreads > 1) {
+            barrier.arriveAndWait();
+        }
+    }
+}
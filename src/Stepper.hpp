@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Barrier.hpp"
+#include "Kernel.hpp"
+#include "aligned.hpp"
+#include "ints.hpp"
+
+// Persistent pool stepping a mesh in row bands. The calling thread works the
+// first band; the others are kept alive across calls and synchronise on a
+// barrier between steps. Each cell goes through the same kernel as the
+// single-threaded path, so results are bit-identical.
+class Stepper {
+   public:
+    // `threads == 0` uses every hardware thread
+    explicit Stepper(usize threads = 0);
+    ~Stepper();
+
+    Stepper(const Stepper&) = delete;
+    Stepper& operator=(const Stepper&) = delete;
+
+    // Advances the padded rows `[1, rows]` of `step` `steps` times, swapping
+    // the roles of `src` and `dst` after each step: the result ends up in
+    // `step.dst` when `steps` is odd and in `step.src` otherwise. `pins` are
+    // re-imposed after every step. When `residual` is given the last step
+    // goes through the monitoring kernel, each band reducing its own rows,
+    // and the bands' results are merged into it.
+    void run(const kernel::Step& step,
+             usize rows,
+             usize steps,
+             const kernel::Pins& pins = {},
+             kernel::Residual* residual = nullptr);
+
+    [[nodiscard]] usize threadCount() const { return nThreads; }
+
+   private:
+    struct Job {
+        kernel::Step step;
+        usize rows;
+        usize steps;
+        kernel::Pins pins;
+        bool monitored;
+    };
+
+    // one per band, on its own cache line
+    struct alignas(cacheLine) Partial {
+        kernel::Residual residual;
+    };
+
+    void work(usize worker);
+    void runBand(usize worker);
+
+    const usize nThreads;
+    const kernel::StepFn kernel;
+    const kernel::MonitorFn monitor;
+
+    Job job{};
+    std::vector<Partial> partials;
+    Barrier barrier;
+    std::atomic<u32> generation{0};
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> workers;
+};
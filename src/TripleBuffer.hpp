@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "ints.hpp"
+
+// Hands the latest of a stream of values from one producer thread to one
+// consumer thread without either of them ever waiting.
+//
+// Of the three slots the producer owns one to fill, the consumer owns one to
+// read, and the third holds the last published value. Publishing and taking
+// both swap the caller's slot with the middle one, and a flag on the middle
+// index tells the consumer whether it is newer than what it holds. Values the
+// consumer was too slow to take are overwritten.
+template <typename T>
+class TripleBuffer {
+   public:
+    explicit TripleBuffer(const T& initial)
+        : slots{initial, initial, initial} {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // producer: the slot to fill, kept across `publish` calls until swapped
+    [[nodiscard]] T& back() { return slots[backIndex]; }
+
+    // producer: makes `back()` the latest value and hands out another slot
+    void publish() {
+        backIndex =
+            middle.exchange(backIndex | fresh, std::memory_order_acq_rel) &
+            indexMask;
+    }
+
+    // consumer: moves to the latest value, returns whether there was a newer
+    // one than `front()`
+    bool take() {
+        if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+            return false;
+        }
+        frontIndex =
+            middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    // consumer: the value taken last, or the initial one
+    [[nodiscard]] const T& front() const { return slots[frontIndex]; }
+
+   private:
+    static constexpr u8 indexMask = 3;
+    static constexpr u8 fresh = 4;
+
+    std::array<T, 3> slots;
+    // each side's index is only touched by its own thread
+    alignas(64) u8 backIndex = 0;
+    alignas(64) u8 frontIndex = 1;
+    alignas(64) std::atomic<u8> middle{2};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "ints.hpp"
+
+// Cache-line alignment, also wide enough for a full AVX-512 register.
+static constexpr usize cacheLine = 64;
+
+template <typename T, usize Alignment = cacheLine>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    constexpr AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    [[nodiscard]] T* allocate(usize n) {
+        const usize bytes = roundUp(n * sizeof(T));
+        void* p = std::aligned_alloc(Alignment, bytes);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, usize) { std::free(p); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const {
+        return true;
+    }
+
+   private:
+    // `aligned_alloc` requires a non-zero multiple of the alignment
+    static constexpr usize roundUp(usize bytes) {
+        if (bytes == 0) {
+            return Alignment;
+        }
+        return (bytes + Alignment - 1) / Alignment * Alignment;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
@@ -0,0 +1,854 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "ActiveRegion.hpp"
+#include "Adi.hpp"
+#include "AmrMesh.hpp"
+#include "ColorMap.hpp"
+#include "Conduction.hpp"
+#include "EnsembleMesh.hpp"
+#include "Frames.hpp"
+#include "Grid.hpp"
+#include "Io.hpp"
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "Multigrid.hpp"
+#include "PackedMesh.hpp"
+#include "PagedMesh.hpp"
+#include "Profiler.hpp"
+#include "Snapshots.hpp"
+#include "Spectral.hpp"
+#include "Stepper.hpp"
+#include "scalars.hpp"
+
+// Headless runner: steps the funnel, or a level file, as fast as possible,
+// reports throughput and dumps the final field.
+
+enum class Integrator {
+    Explicit,
+    Adi,
+    Conduction,
+    Amr,
+    Spectral,
+};
+
+// steps between two `AmrMesh::adapt` when refining from the field
+static constexpr usize regridInterval = 100;
+
+struct Options {
+    Integrator integrator = Integrator::Explicit;
+    // only the implicit integrator can take other time steps
+    float dt = poss::Mesh::dt;
+    // conduction integrator only, adapt dt down to this local error
+    bool adaptive = false;
+    float adaptiveTolerance = 0.0f;
+    // amr integrator only, pick tile levels from the field instead of the
+    // layout
+    bool refine = false;
+    float refineThreshold = 0.0f;
+    usize steps = 10000;
+    // solve for equilibrium with multigrid instead of stepping
+    bool steady = false;
+    float tolerance = 1e-5f;
+    // explicit integrator only, stop once a step moves no cell by
+    // `convergeTolerance` degrees, checked every `checkEvery` steps
+    bool converge = false;
+    float convergeTolerance = 0.0f;
+    usize checkEvery = 100;
+    // skip blocks that changed less than `threshold` on their last step
+    bool active = false;
+    float threshold = 0.0f;
+    // explicit integrator only, members stepped together with conductivities
+    // spread up to the mesh's, 0 for a single run
+    usize ensemble = 0;
+    // explicit integrator only, temperature planes in this format
+    std::string storage = Storage<float>::name;
+    // explicit integrator only, planes in a file mapped at this path and
+    // paged through at most `resident` MiB, 0 for half the memory
+    std::string paged;
+    usize resident = 0;
+    usize subdivision = 8;
+    usize threads = 0;
+    // the funnel when empty
+    std::string level;
+    // time series written every `every` steps, resumed from when `resume`
+    std::string snapshots;
+    usize every = 1000;
+    bool resume = false;
+    std::string output = "field.raw";
+    // video of the field, a frame every `frameEvery` steps
+    std::string frames;
+    usize frameEvery = 100;
+    usize scale = 1;
+    std::string colormap = "inferno";
+    // Chrome trace of the profiler spans, written at the end
+    std::string trace;
+};
+
+// the run's summary, moved to stderr when the frames stream to stdout
+static std::FILE* summary = stdout;
+
+static void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s "
+                 "[--integrator explicit|adi|conduction|amr|spectral] "
+                 "[--dt DT] [--adaptive TOLERANCE] [--refine THRESHOLD] "
+                 "[--steps N] "
+                 "[--steady TOLERANCE] [--converge TOLERANCE] "
+                 "[--check-every N] [--active THRESHOLD] "
+                 "[--storage float|double|half|bf16|u16] [--ensemble M] "
+                 "[--paged PATH] [--resident MIB] "
+                 "[--subdivision S] "
+                 "[--threads T] [--level PATH] [--snapshots PATH] "
+                 "[--resume PATH] [--every N] [--output PATH] "
+                 "[--frames PATH] [--frame-every N] [--scale S] "
+                 "[--colormap inferno|viridis|catpuccin] [--trace PATH]\n"
+                 "  --dt      time step of the adi integrator, the explicit "
+                 "one is fixed\n"
+                 "  --integrator conduction  per-cell conductivity at the "
+                 "largest stable dt\n"
+                 "  --adaptive  let the conduction integrator shrink dt to "
+                 "keep each step's error under the tolerance\n"
+                 "  --integrator amr  each tile at its own subdivision, up "
+                 "to --subdivision, a power of two\n"
+                 "  --integrator spectral  homogeneous rectangles propagated "
+                 "exactly by cosine transforms, the rest explicitly\n"
+                 "  --refine  let the amr integrator re-pick tile levels so "
+                 "no cell spans more than THRESHOLD degrees\n"
+                 "  --steady  solve for equilibrium with multigrid down to "
+                 "the relative residual\n"
+                 "  --converge  stop stepping once a step changes no cell by "
+                 "TOLERANCE degrees, measured every --check-every steps\n"
+                 "  --active  skip blocks whose cells moved less than the "
+                 "threshold, 0 is exact\n"
+                 "  --storage  format of the temperature planes, anything but "
+                 "float steps on one thread\n"
+                 "  --ensemble  step M members at once, member m at "
+                 "(m + 1) / M of the conductivity; the output is the last\n"
+                 "  --paged   keep the planes in a new file mapped at PATH, "
+                 "which must not exist and is deleted when done, and stream "
+                 "it from disk once the mesh outgrows --resident\n"
+                 "  --level   `.hfl` loads a binary level, anything else a "
+                 "text map\n"
+                 "  --snapshots  time series written every --every steps\n"
+                 "  --resume  continue a time series, up to --steps in "
+                 "total\n"
+                 "  --output  `.pgm` writes an 8-bit image, anything else raw "
+                 "float32\n"
+                 "  --frames  colour-mapped video every --frame-every steps, "
+                 "Y4M for `-` (stdout) or `.y4m`, numbered PPMs after the "
+                 "prefix otherwise\n"
+                 "  --scale   pixels along the side of a cell in the frames\n"
+                 "  --trace   Chrome trace-event JSON of the last profiler "
+                 "spans, needs a HEATFLOW_PROFILE build\n",
+                 program);
+}
+
+static bool parseUsize(const char* s, usize& out) {
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(s, &end, 10);
+    if (end == s || *end != '\0') {
+        return false;
+    }
+    out = static_cast<usize>(value);
+    return true;
+}
+
+// float storage is the mesh itself
+using Packed = std::variant<PackedMesh<double>,
+                            PackedMesh<Half>,
+                            PackedMesh<BFloat16>,
+                            PackedMesh<Fixed16>>;
+
+static bool validStorage(const std::string& storage) {
+    return storage == Storage<float>::name ||
+           storage == Storage<double>::name ||
+           storage == Storage<Half>::name ||
+           storage == Storage<BFloat16>::name ||
+           storage == Storage<Fixed16>::name;
+}
+
+template <typename T>
+static void packAs(const poss::Mesh& mesh,
+                   const std::string& storage,
+                   std::optional<Packed>& packed) {
+    if (storage == Storage<T>::name) {
+        packed.emplace(std::in_place_type<PackedMesh<T>>, mesh);
+    }
+}
+
+static std::optional<Packed> pack(const poss::Mesh& mesh,
+                                  const std::string& storage) {
+    std::optional<Packed> packed;
+    packAs<double>(mesh, storage, packed);
+    packAs<Half>(mesh, storage, packed);
+    packAs<BFloat16>(mesh, storage, packed);
+    packAs<Fixed16>(mesh, storage, packed);
+    return packed;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            return false;
+        } else if (std::strcmp(arg, "--integrator") == 0) {
+            if (std::strcmp(value, "explicit") == 0) {
+                options.integrator = Integrator::Explicit;
+            } else if (std::strcmp(value, "adi") == 0) {
+                options.integrator = Integrator::Adi;
+            } else if (std::strcmp(value, "conduction") == 0) {
+                options.integrator = Integrator::Conduction;
+            } else if (std::strcmp(value, "amr") == 0) {
+                options.integrator = Integrator::Amr;
+            } else if (std::strcmp(value, "spectral") == 0) {
+                options.integrator = Integrator::Spectral;
+            } else {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--dt") == 0) {
+            char* end = nullptr;
+            options.dt = std::strtof(value, &end);
+            if (end == value || *end != '\0' || !(options.dt > 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--adaptive") == 0) {
+            char* end = nullptr;
+            options.adaptive = true;
+            options.adaptiveTolerance = std::strtof(value, &end);
+            if (end == value || *end != '\0' ||
+                !(options.adaptiveTolerance > 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--refine") == 0) {
+            char* end = nullptr;
+            options.refine = true;
+            options.refineThreshold = std::strtof(value, &end);
+            if (end == value || *end != '\0' ||
+                !(options.refineThreshold > 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--steady") == 0) {
+            char* end = nullptr;
+            options.steady = true;
+            options.tolerance = std::strtof(value, &end);
+            if (end == value || *end != '\0' || !(options.tolerance > 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--converge") == 0) {
+            char* end = nullptr;
+            options.converge = true;
+            options.convergeTolerance = std::strtof(value, &end);
+            if (end == value || *end != '\0' ||
+                !(options.convergeTolerance > 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--check-every") == 0) {
+            if (!parseUsize(value, options.checkEvery) ||
+                options.checkEvery == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--active") == 0) {
+            char* end = nullptr;
+            options.active = true;
+            options.threshold = std::strtof(value, &end);
+            if (end == value || *end != '\0' ||
+                !(options.threshold >= 0.0f)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--storage") == 0) {
+            options.storage = value;
+            if (!validStorage(options.storage)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--ensemble") == 0) {
+            if (!parseUsize(value, options.ensemble) || options.ensemble == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--paged") == 0) {
+            options.paged = value;
+        } else if (std::strcmp(arg, "--resident") == 0) {
+            if (!parseUsize(value, options.resident) || options.resident == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--steps") == 0) {
+            if (!parseUsize(value, options.steps)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--subdivision") == 0) {
+            if (!parseUsize(value, options.subdivision) ||
+                options.subdivision == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            if (!parseUsize(value, options.threads)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--level") == 0) {
+            options.level = value;
+        } else if (std::strcmp(arg, "--snapshots") == 0 ||
+                   std::strcmp(arg, "--resume") == 0) {
+            options.snapshots = value;
+            options.resume = std::strcmp(arg, "--resume") == 0;
+        } else if (std::strcmp(arg, "--every") == 0) {
+            if (!parseUsize(value, options.every) || options.every == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--output") == 0) {
+            options.output = value;
+        } else if (std::strcmp(arg, "--frames") == 0) {
+            options.frames = value;
+        } else if (std::strcmp(arg, "--frame-every") == 0) {
+            if (!parseUsize(value, options.frameEvery) ||
+                options.frameEvery == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--scale") == 0) {
+            if (!parseUsize(value, options.scale) || options.scale == 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--colormap") == 0) {
+            options.colormap = value;
+            if (options.colormap != "inferno" &&
+                options.colormap != "viridis" &&
+                options.colormap != "catpuccin") {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--trace") == 0) {
+            options.trace = value;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+static ColorMap colorMap(const std::string& name) {
+    if (name == "viridis") {
+        return ColorMap::Viridis();
+    } else if (name == "catpuccin") {
+        return ColorMap::Catpuccin();
+    }
+    return ColorMap::Inferno();
+}
+
+// a `poss::Mesh` or a `PagedMesh`
+template <typename Field>
+static int writeOutput(const Field& mesh, const Options& options) {
+    if (!io::writeField(mesh, options.output)) {
+        std::fprintf(stderr, "failed to write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+    std::fprintf(summary, "output      %s\n", options.output.c_str());
+
+    if (!options.trace.empty()) {
+        if (!profile::writeChromeTrace(options.trace)) {
+            std::fprintf(stderr, "failed to write %s\n", options.trace.c_str());
+            return EXIT_FAILURE;
+        }
+        std::fprintf(summary, "trace       %s\n", options.trace.c_str());
+    }
+    return EXIT_SUCCESS;
+}
+
+static int solveSteady(const Grid& grid,
+                       poss::Mesh& mesh,
+                       const Options& options) {
+    const auto start = std::chrono::steady_clock::now();
+    Multigrid multigrid(grid, options.subdivision);
+    const Multigrid::Report report = multigrid.solve(
+        mesh, mesh.thermostats, {.tolerance = options.tolerance});
+    const auto end = std::chrono::steady_clock::now();
+
+    std::fprintf(summary, "mesh        %zu x %zu\n", mesh.width, mesh.height);
+    std::fprintf(summary, "levels      %zu\n", multigrid.levelCount());
+    for (usize i = 0; i < report.residuals.size(); ++i) {
+        std::fprintf(summary, "cycle %-5zu residual %.6e\n", i,
+                     report.residuals[i]);
+    }
+    std::fprintf(summary, "converged   %s\n", report.converged ? "yes" : "no");
+    std::fprintf(summary, "elapsed     %.3f s\n",
+                 std::chrono::duration<double>(end - start).count());
+
+    return writeOutput(mesh, options);
+}
+
+static int runPaged(const Grid& grid, const Options& options) {
+    PagedMesh mesh(grid, options.subdivision, options.paged,
+                   PagedMesh::Options{.resident = options.resident << 20});
+    if (!mesh.ok()) {
+        std::fprintf(stderr, "failed to create %s, which must not exist\n",
+                     options.paged.c_str());
+        return EXIT_FAILURE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    mesh.advance(options.steps);
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const PagedMesh::Stats& stats = mesh.stats();
+    constexpr double mib = 1024.0 * 1024.0;
+
+    std::fprintf(summary, "mesh        %zu x %zu\n", mesh.width(),
+                 mesh.height());
+    std::fprintf(summary, "integrator  explicit\n");
+    std::fprintf(summary, "kernel      %s\n",
+                 kernel::name(kernel::detect()));
+    std::fprintf(summary, "paged       %.1f MiB, %s\n", mesh.fileBytes() / mib,
+                 mesh.paging() ? "streamed" : "resident");
+    std::fprintf(summary,
+                 "sweeps      %zu of up to %zu steps, bands of %zu rows\n",
+                 stats.sweeps, mesh.depth(), mesh.bandRows());
+    std::fprintf(summary,
+                 "paged in    %.1f MiB read, %.1f MiB advised, %zu major "
+                 "faults\n",
+                 stats.read / mib, stats.advised / mib, stats.majorFaults);
+    std::fprintf(summary, "paged out   %.1f MiB\n", stats.evicted / mib);
+    std::fprintf(summary, "steps       %zu\n", options.steps);
+    std::fprintf(summary, "simulated   %g\n",
+                 static_cast<double>(poss::Mesh::dt) * options.steps);
+    std::fprintf(summary, "elapsed     %.3f s\n", seconds);
+    std::fprintf(summary, "throughput  %.3e cell-updates/s\n",
+                 static_cast<double>(mesh.cellCount()) * options.steps /
+                     seconds);
+
+    return writeOutput(mesh, options);
+}
+
+// `option` is set but `requirement` is not met
+static bool lacks(bool option,
+                  const char* name,
+                  bool requirement,
+                  const char* required) {
+    if (option && !requirement) {
+        std::fprintf(stderr, "%s needs %s\n", name, required);
+        return true;
+    }
+    return false;
+}
+
+// both options are set but cannot run together
+static bool conflict(bool first,
+                     const char* firstName,
+                     bool second,
+                     const char* secondName) {
+    if (first && second) {
+        std::fprintf(stderr, "%s cannot be combined with %s\n", firstName,
+                     secondName);
+        return true;
+    }
+    return false;
+}
+
+// Checks the combination of options one rule at a time and explains the
+// first one broken.
+static bool validate(const Options& options) {
+    const bool isExplicit = options.integrator == Integrator::Explicit;
+    const bool amr = options.integrator == Integrator::Amr;
+    const bool spectral = options.integrator == Integrator::Spectral;
+    const bool storage = options.storage != Storage<float>::name;
+    const bool ensemble = options.ensemble != 0;
+    const bool paged = !options.paged.empty();
+    const bool snapshots = !options.snapshots.empty();
+    const bool frames = !options.frames.empty();
+
+    // options of a single integrator
+    if (lacks(options.dt != poss::Mesh::dt, "--dt",
+              options.integrator == Integrator::Adi, "--integrator adi") ||
+        lacks(options.adaptive, "--adaptive",
+              options.integrator == Integrator::Conduction,
+              "--integrator conduction") ||
+        lacks(options.refine, "--refine", amr, "--integrator amr") ||
+        lacks(options.active, "--active", isExplicit,
+              "the explicit integrator") ||
+        lacks(storage, "--storage", isExplicit, "the explicit integrator") ||
+        lacks(ensemble, "--ensemble", isExplicit, "the explicit integrator") ||
+        lacks(paged, "--paged", isExplicit, "the explicit integrator") ||
+        lacks(options.converge, "--converge", isExplicit,
+              "the explicit integrator")) {
+        return false;
+    }
+
+    if (lacks(amr, "--integrator amr",
+              std::has_single_bit(options.subdivision),
+              "a power of two --subdivision") ||
+        lacks(options.resident != 0, "--resident", paged, "--paged") ||
+        lacks(!options.trace.empty(), "--trace", profile::enabled,
+              "a HEATFLOW_PROFILE build")) {
+        return false;
+    }
+
+    // the multigrid solve does not step at all
+    if (conflict(options.steady, "--steady", amr, "--integrator amr") ||
+        conflict(options.steady, "--steady", spectral,
+                 "--integrator spectral") ||
+        conflict(options.steady, "--steady", storage, "--storage") ||
+        conflict(options.steady, "--steady", ensemble, "--ensemble") ||
+        conflict(options.steady, "--steady", paged, "--paged") ||
+        conflict(options.steady, "--steady", options.converge,
+                 "--converge") ||
+        conflict(options.steady, "--steady", frames, "--frames")) {
+        return false;
+    }
+
+    // alternative ways of stepping the explicit scheme
+    if (conflict(options.active, "--active", storage, "--storage") ||
+        conflict(options.active, "--active", ensemble, "--ensemble") ||
+        conflict(options.active, "--active", paged, "--paged") ||
+        conflict(options.active, "--active", options.converge,
+                 "--converge") ||
+        conflict(storage, "--storage", ensemble, "--ensemble") ||
+        conflict(storage, "--storage", paged, "--paged") ||
+        conflict(storage, "--storage", options.converge, "--converge") ||
+        conflict(ensemble, "--ensemble", paged, "--paged") ||
+        conflict(ensemble, "--ensemble", options.converge, "--converge") ||
+        conflict(paged, "--paged", options.converge, "--converge")) {
+        return false;
+    }
+
+    // the paged field never comes back into memory whole
+    if (conflict(paged, "--paged", snapshots, "--snapshots") ||
+        conflict(paged, "--paged", frames, "--frames")) {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!validate(options)) {
+        return EXIT_FAILURE;
+    }
+    if (options.frames == "-") {
+        summary = stderr;
+    }
+
+    profile::nameThread("main");
+
+    // binary levels skip the grid unless multigrid, the tile levels or the
+    // paged planes are built from it
+    std::optional<Grid> grid;
+    std::optional<poss::Mesh> mesh;
+    if (options.level.empty()) {
+        grid = Grid::funnel();
+    } else if (options.level.ends_with(".hfl") && !options.steady &&
+               options.integrator != Integrator::Amr && options.paged.empty()) {
+        mesh = io::mapLevel(options.level, options.subdivision);
+    } else {
+        grid = io::readLevel(options.level);
+    }
+    if (grid && !options.paged.empty()) {
+        return runPaged(*grid, options);
+    }
+    if (grid) {
+        mesh = poss::Mesh::fromGrid(*grid, options.subdivision);
+    }
+    if (!mesh) {
+        std::fprintf(stderr, "failed to load %s\n", options.level.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (options.steady) {
+        return solveSteady(*grid, *mesh, options);
+    }
+
+    usize first = 0;
+    if (options.resume) {
+        const std::optional<u64> step =
+            resumeSnapshot(options.snapshots, *mesh);
+        if (!step) {
+            std::fprintf(stderr, "no checkpoint in %s\n",
+                         options.snapshots.c_str());
+            return EXIT_FAILURE;
+        }
+        first = std::min(static_cast<usize>(*step), options.steps);
+    }
+
+    std::optional<SnapshotWriter> snapshots;
+    if (!options.snapshots.empty()) {
+        snapshots.emplace(options.snapshots, *mesh,
+                          SnapshotWriter::Options{.append = options.resume});
+        if (!snapshots->ok()) {
+            std::fprintf(stderr, "failed to open %s\n",
+                         options.snapshots.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    Stepper stepper(options.threads);
+    std::optional<Adi> adi;
+    std::optional<Conduction> conduction;
+    std::optional<ActiveRegion> region;
+    std::optional<AmrMesh> amr;
+    std::optional<Spectral> spectral;
+    if (options.integrator == Integrator::Adi) {
+        adi.emplace(*mesh);
+    } else if (options.integrator == Integrator::Spectral) {
+        spectral.emplace(*mesh, Spectral::Options{});
+    } else if (options.integrator == Integrator::Amr) {
+        amr.emplace(*grid, *mesh);
+    } else if (options.integrator == Integrator::Conduction) {
+        conduction.emplace(
+            *mesh, Conduction::Options{.adaptive = options.adaptive,
+                                       .tolerance = options.adaptiveTolerance});
+    } else if (options.active) {
+        region.emplace(*mesh,
+                       ActiveRegion::Options{.threshold = options.threshold});
+    }
+
+    std::optional<Packed> packed = pack(*mesh, options.storage);
+
+    std::optional<EnsembleMesh> ensemble;
+    if (options.ensemble != 0) {
+        std::vector<EnsembleMesh::Member> members(options.ensemble);
+        for (usize m = 0; m < members.size(); ++m) {
+            members[m].conductivity =
+                poss::Mesh::conductivity * (m + 1) / members.size();
+        }
+        ensemble.emplace(*mesh, members);
+    }
+    // brings the mesh up to date before anything reads it
+    const auto unpack = [&] {
+        if (packed) {
+            std::visit([&](const auto& p) { p.unpack(*mesh); }, *packed);
+        } else if (amr) {
+            amr->paint(*mesh);
+        } else if (ensemble) {
+            ensemble->extract(ensemble->memberCount() - 1, *mesh);
+        }
+    };
+
+    usize activeBlocks = 0;
+    usize blocks = 0;
+    // the amr cell count changes as tiles are refined
+    double amrUpdates = 0.0;
+    usize regrids = 0;
+    usize sinceRegrid = 0;
+    double simulated = 0.0;
+    // only the plain explicit path measures its last step into `residual`
+    const auto advance = [&](usize steps, kernel::Residual* residual) {
+        if (adi) {
+            for (usize _ = 0; _ < steps; ++_) {
+                adi->step(*mesh, options.dt);
+            }
+        } else if (spectral) {
+            spectral->advance(*mesh, steps);
+        } else if (conduction) {
+            for (usize _ = 0; _ < steps; ++_) {
+                simulated += conduction->step(*mesh);
+            }
+            return;
+        } else if (amr) {
+            for (usize _ = 0; _ < steps; ++_) {
+                simulated += amr->step();
+                amrUpdates += static_cast<double>(amr->cellCount());
+                if (options.refine && ++sinceRegrid == regridInterval) {
+                    regrids += amr->adapt(options.refineThreshold) ? 1 : 0;
+                    sinceRegrid = 0;
+                }
+            }
+            return;
+        } else if (region) {
+            for (usize _ = 0; _ < steps; ++_) {
+                const ActiveRegion::Stats stats = region->step(*mesh);
+                activeBlocks += stats.active;
+                blocks += stats.blocks;
+            }
+        } else if (packed) {
+            std::visit([&](auto& p) { p.update(steps); }, *packed);
+        } else if (ensemble) {
+            ensemble->update(steps);
+        } else if (stepper.threadCount() == 1) {
+            // nothing to share, so trade the band barriers for cache reuse
+            mesh->advance(steps, residual);
+        } else {
+            mesh->update(stepper, steps, residual);
+        }
+        simulated += static_cast<double>(options.dt) * steps;
+    };
+
+    std::optional<FrameWriter> frames;
+    if (!options.frames.empty()) {
+        frames.emplace(options.frames, *mesh, colorMap(options.colormap),
+                       FrameWriter::Options{
+                           .format = FrameWriter::formatFor(options.frames),
+                           .scale = options.scale,
+                       });
+        if (!frames->ok()) {
+            std::fprintf(stderr, "failed to open %s\n",
+                         options.frames.c_str());
+            return EXIT_FAILURE;
+        }
+        frames->push(*mesh);
+    }
+
+    // steps up to the next snapshot, frame or convergence check
+    const auto chunkFrom = [&](usize done) {
+        usize next = options.steps;
+        if (options.converge) {
+            next = std::min(
+                next, done + options.checkEvery - done % options.checkEvery);
+        }
+        if (snapshots) {
+            next = std::min(next, done + options.every - done % options.every);
+        }
+        if (frames) {
+            next = std::min(
+                next, done + options.frameEvery - done % options.frameEvery);
+        }
+        return next - done;
+    };
+
+    kernel::Residual residual;
+    // heat at the first check, to see how far it drifted by the last
+    std::optional<double> initialHeat;
+    bool converged = false;
+    usize done = first;
+
+    const auto start = std::chrono::steady_clock::now();
+    while (done < options.steps && !converged) {
+        const usize chunk = chunkFrom(done);
+        const bool check =
+            options.converge && ((done + chunk) % options.checkEvery == 0 ||
+                                 done + chunk == options.steps);
+        advance(chunk, check ? &residual : nullptr);
+        done += chunk;
+        if (check) {
+            initialHeat = initialHeat.value_or(residual.heat);
+            converged = residual.maxChange < options.convergeTolerance;
+        }
+
+        const bool last = done == options.steps || converged;
+        const bool snapshot = snapshots && (done % options.every == 0 || last);
+        const bool frame = frames && done % options.frameEvery == 0;
+        if (snapshot || frame) {
+            unpack();
+        }
+        // the last frame is the checkpoint, so it is worth waiting for
+        if (snapshot) {
+            snapshots->push(*mesh, done, last);
+        }
+        if (frame) {
+            frames->push(*mesh);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const usize steps = done - first;
+    unpack();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    // every member counts
+    const double cellUpdates =
+        amr ? amrUpdates
+            : static_cast<double>(mesh->cellCount()) * steps *
+                  (ensemble ? ensemble->memberCount() : 1);
+
+    std::fprintf(summary, "mesh        %zu x %zu\n", mesh->width, mesh->height);
+    if (options.integrator == Integrator::Adi) {
+        std::fprintf(summary, "integrator  adi\n");
+    } else if (options.integrator == Integrator::Conduction) {
+        std::fprintf(summary, "integrator  conduction\n");
+        std::fprintf(summary, "stable dt   %g\n", conduction->stableDt());
+    } else if (options.integrator == Integrator::Spectral) {
+        std::fprintf(summary, "integrator  spectral\n");
+        std::fprintf(summary, "regions     %zu, %.1f%% of cells\n",
+                     spectral->regions().size(),
+                     100.0 * spectral->spectralCells() / mesh->cellCount());
+        for (const Spectral::Region& r : spectral->regions()) {
+            std::fprintf(summary, "            %zu x %zu at %zu, %zu%s\n",
+                         r.width, r.height, r.col, r.row,
+                         r.closed ? ", closed" : "");
+        }
+        if (spectral->passSteps() != 0) {
+            std::fprintf(summary, "passes      %zu, up to %zu steps\n",
+                         spectral->passCount(), spectral->passSteps());
+        } else {
+            std::fprintf(summary, "passes      %zu\n",
+                         spectral->passCount());
+        }
+    } else if (options.integrator == Integrator::Amr) {
+        std::fprintf(summary, "integrator  amr\n");
+        std::fprintf(summary, "cells       %zu, %.1f%% of uniform\n",
+                     amr->cellCount(),
+                     100.0 * amr->cellCount() / mesh->cellCount());
+        std::fprintf(summary, "stable dt   %g\n", amr->stableDt());
+        std::fprintf(summary, "heat        %.6e\n", amr->heat());
+        if (options.refine) {
+            std::fprintf(summary, "regrids     %zu\n", regrids);
+        }
+    } else {
+        std::fprintf(summary, "integrator  explicit\n");
+        std::fprintf(summary, "kernel      %s\n",
+                     kernel::name(kernel::detect()));
+        std::fprintf(summary, "storage     %s\n", options.storage.c_str());
+        if (ensemble) {
+            std::fprintf(summary, "ensemble    %zu members in %zu lanes\n",
+                         ensemble->memberCount(), ensemble->laneCount());
+        }
+        if (options.active) {
+            std::fprintf(summary, "active      %.1f%% of blocks\n",
+                         blocks == 0 ? 0.0 : 100.0 * activeBlocks / blocks);
+        } else {
+            std::fprintf(summary, "threads     %zu\n",
+                         packed || ensemble ? 1 : stepper.threadCount());
+        }
+    }
+    if (options.converge) {
+        if (converged) {
+            std::fprintf(summary, "converged   at step %zu\n", done);
+        } else {
+            std::fprintf(summary, "converged   no\n");
+        }
+        std::fprintf(summary, "change      %.3e max, %.3e l2\n",
+                     residual.maxChange, residual.norm());
+        std::fprintf(summary, "heat        %.6e, %+.3e since the first check\n",
+                     residual.heat, residual.heat - initialHeat.value_or(0.0));
+    }
+    std::fprintf(summary, "steps       %zu\n", steps);
+    std::fprintf(summary, "simulated   %g\n", simulated);
+    std::fprintf(summary, "elapsed     %.3f s\n", seconds);
+    std::fprintf(summary, "throughput  %.3e cell-updates/s\n",
+                 cellUpdates / seconds);
+
+    if (frames) {
+        frames->close();
+        const FrameWriter::Stats stats = frames->stats();
+        std::fprintf(summary, "frames      %zu written, %zu bytes\n",
+                     stats.frames, stats.bytes);
+        if (!frames->ok()) {
+            std::fprintf(stderr, "failed to write %s\n",
+                         options.frames.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (snapshots) {
+        snapshots->close();
+        const SnapshotWriter::Stats stats = snapshots->stats();
+        std::fprintf(summary,
+                     "snapshots   %zu written, %zu dropped, %zu bytes\n",
+                     stats.written, stats.dropped, stats.bytes);
+        if (stats.failed) {
+            std::fprintf(stderr, "failed to write %s\n",
+                         options.snapshots.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    return writeOutput(*mesh, options);
+}
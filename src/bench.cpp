@@ -0,0 +1,451 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ActiveRegion.hpp"
+#include "ColorMap.hpp"
+#include "Grid.hpp"
+#include "Io.hpp"
+#include "Kernel.hpp"
+#include "Mesh.hpp"
+#include "PackedMesh.hpp"
+#include "Rgb.hpp"
+#include "Stepper.hpp"
+#include "scalars.hpp"
+
+// Benchmarks the solver phases on scaled-up funnels and prints one JSON
+// document so results can be diffed across builds.
+
+struct Options {
+    std::vector<usize> scales = {1, 2, 4, 8};
+    std::vector<usize> subdivisions = {4, 8};
+    usize iterations = 20;
+    usize warmup = 2;
+    usize repeats = 5;
+    usize threads = 0;
+    std::string output;
+};
+
+struct Result {
+    std::string benchmark;
+    std::string kernel;
+    usize threads;
+    usize scale;
+    usize subdivision;
+    usize width;
+    usize height;
+    usize iterations;
+    double secondsMin;
+    double secondsMedian;
+    // estimated memory traffic, reads and writes
+    usize bytesPerCell;
+};
+
+// a reduced-precision storage against the double baseline, after the same
+// steps from the same field
+struct Accuracy {
+    std::string storage;
+    usize scale;
+    usize subdivision;
+    usize steps;
+    double maxError;
+    double rmsError;
+};
+
+static void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--scales 1,2,4,8] [--subdivisions 4,8] "
+                 "[--iterations N] [--warmup N] [--repeats N] [--threads T] "
+                 "[--output PATH]\n",
+                 program);
+}
+
+static bool parseUsize(const char* s, usize& out) {
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(s, &end, 10);
+    if (end == s || *end != '\0') {
+        return false;
+    }
+    out = static_cast<usize>(value);
+    return true;
+}
+
+static bool parseList(const char* s, std::vector<usize>& out) {
+    out.clear();
+    std::string item;
+    for (const char* c = s;; ++c) {
+        if (*c == ',' || *c == '\0') {
+            usize value;
+            if (!parseUsize(item.c_str(), value) || value == 0) {
+                return false;
+            }
+            out.push_back(value);
+            item.clear();
+            if (*c == '\0') {
+                return true;
+            }
+        } else {
+            item.push_back(*c);
+        }
+    }
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            return false;
+        }
+
+        bool ok = true;
+        if (std::strcmp(arg, "--scales") == 0) {
+            ok = parseList(value, options.scales);
+        } else if (std::strcmp(arg, "--subdivisions") == 0) {
+            ok = parseList(value, options.subdivisions);
+        } else if (std::strcmp(arg, "--iterations") == 0) {
+            ok = parseUsize(value, options.iterations) &&
+                 options.iterations != 0;
+        } else if (std::strcmp(arg, "--warmup") == 0) {
+            ok = parseUsize(value, options.warmup);
+        } else if (std::strcmp(arg, "--repeats") == 0) {
+            ok = parseUsize(value, options.repeats) && options.repeats != 0;
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            ok = parseUsize(value, options.threads);
+        } else if (std::strcmp(arg, "--output") == 0) {
+            options.output = value;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+// runs `fn` `warmup` times untimed, then `repeats` timed runs
+template <typename F>
+static std::vector<double> measure(const Options& options, F&& fn) {
+    for (usize _ = 0; _ < options.warmup; ++_) {
+        fn();
+    }
+
+    std::vector<double> seconds;
+    seconds.reserve(options.repeats);
+    for (usize _ = 0; _ < options.repeats; ++_) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+    return seconds;
+}
+
+static void colorize(const poss::Mesh& mesh,
+                     const ColorMap& cmap,
+                     std::vector<Rgba>& pixels) {
+    for (usize row = 0; row < mesh.height; ++row) {
+        for (usize col = 0; col < mesh.width; ++col) {
+            const usize i = mesh.index(col, row);
+
+            Rgba color = catpuccin::DarkGray.opaque();
+            if (mesh.mask[i] & poss::Mesh::Flag::Conducts) {
+                color = cmap.get(mesh.temperature[i] / 255.0f).opaque();
+            }
+            pixels[row * mesh.width + col] = color;
+        }
+    }
+}
+
+// the renderer's path: one table pass per row, then insulators
+static void colorizeLut(const poss::Mesh& mesh,
+                        const ColorMap& cmap,
+                        std::vector<Rgba>& pixels) {
+    const Rgba background = catpuccin::DarkGray.opaque();
+
+    for (usize row = 0; row < mesh.height; ++row) {
+        const usize begin = mesh.index(0, row);
+        Rgba* line = pixels.data() + row * mesh.width;
+
+        cmap.colorize({mesh.temperature.data() + begin, mesh.width},
+                      {line, mesh.width}, 0.0f, 255.0f);
+        for (usize col = 0; col < mesh.width; ++col) {
+            if (!(mesh.mask[begin + col] & poss::Mesh::Flag::Conducts)) {
+                line[col] = background;
+            }
+        }
+    }
+}
+
+// largest and root mean square difference over the conducting cells
+static std::pair<double, double> difference(const poss::Mesh& a,
+                                            const poss::Mesh& b) {
+    double max = 0.0;
+    double squares = 0.0;
+    usize count = 0;
+    for (usize i = 0; i < a.temperature.size(); ++i) {
+        if (a.mask[i] & poss::Mesh::Flag::Conducts) {
+            const double error = std::fabs(static_cast<double>(
+                a.temperature[i] - b.temperature[i]));
+            max = std::max(max, error);
+            squares += error * error;
+            ++count;
+        }
+    }
+    return {max, count == 0 ? 0.0 : std::sqrt(squares / count)};
+}
+
+// Times `PackedMesh<T>` from the field in `mesh`, and leaves the field its
+// warmup and timed runs ended on in `out`.
+template <typename T>
+static std::vector<double> benchPacked(const Options& options,
+                                       const poss::Mesh& mesh,
+                                       poss::Mesh& out) {
+    PackedMesh<T> packed(mesh);
+    const auto seconds =
+        measure(options, [&] { packed.update(options.iterations); });
+    packed.unpack(out);
+    return seconds;
+}
+
+static void benchMesh(const Options& options,
+                      usize scale,
+                      usize subdivision,
+                      Stepper& stepper,
+                      std::vector<Result>& results,
+                      std::vector<Accuracy>& accuracy) {
+    const Grid grid = Grid::funnel().repeated(scale, scale);
+    poss::Mesh mesh = poss::Mesh::fromGrid(grid, subdivision);
+
+    const auto record = [&](const char* benchmark, const char* kernel,
+                            usize threads, usize bytesPerCell,
+                            const std::vector<double>& seconds) {
+        results.push_back({
+            .benchmark = benchmark,
+            .kernel = kernel,
+            .threads = threads,
+            .scale = scale,
+            .subdivision = subdivision,
+            .width = mesh.width,
+            .height = mesh.height,
+            .iterations = options.iterations,
+            .secondsMin = seconds.front(),
+            .secondsMedian = seconds[seconds.size() / 2],
+            .bytesPerCell = bytesPerCell,
+        });
+    };
+
+    // temperature in, mask in, temperature out
+    constexpr usize stencilBytes = 2 * sizeof(float) + sizeof(u8);
+
+    for (kernel::Isa isa : {kernel::Isa::Scalar, kernel::Isa::Sse41,
+                            kernel::Isa::Avx2, kernel::Isa::Avx512}) {
+        if (!kernel::supported(isa)) {
+            continue;
+        }
+        const kernel::StepFn fn = kernel::get(isa);
+        const auto seconds = measure(options, [&] {
+            for (usize _ = 0; _ < options.iterations; ++_) {
+                fn(mesh.stepArgs(), mesh.stride,
+                   (mesh.height + 1) * mesh.stride);
+                std::swap(mesh.temperature, mesh.scratch);
+            }
+        });
+        record("update", kernel::name(isa), 1, stencilBytes, seconds);
+    }
+
+    record("stepper", kernel::name(kernel::detect()), stepper.threadCount(),
+           stencilBytes, measure(options, [&] {
+               mesh.update(stepper, options.iterations);
+           }));
+
+    record("advance", kernel::name(kernel::detect()), 1, stencilBytes,
+           measure(options, [&] { mesh.advance(options.iterations); }));
+
+    // Storage formats. Every one starts from the same field and takes the
+    // same steps, so the fields they end on are compared with double's.
+    {
+        const usize steps =
+            options.iterations * (options.warmup + options.repeats);
+        poss::Mesh baseline = mesh;
+        poss::Mesh packed = mesh;
+
+        const auto run = [&]<typename T>(poss::Mesh& out) {
+            record("packed", Storage<T>::name, 1, PackedMesh<T>::bytesPerCell,
+                   benchPacked<T>(options, mesh, out));
+        };
+        const auto compare = [&]<typename T>() {
+            run.operator()<T>(packed);
+            const auto [max, rms] = difference(baseline, packed);
+            accuracy.push_back({
+                .storage = Storage<T>::name,
+                .scale = scale,
+                .subdivision = subdivision,
+                .steps = steps,
+                .maxError = max,
+                .rmsError = rms,
+            });
+        };
+
+        run.operator()<double>(baseline);
+        compare.operator()<float>();
+        compare.operator()<Half>();
+        compare.operator()<BFloat16>();
+        compare.operator()<Fixed16>();
+    }
+
+    // exact skipping, so only blocks with nothing left to do are saved
+    ActiveRegion region(mesh, {.threshold = 0.0f});
+    record("active", kernel::name(kernel::detect()), 1, stencilBytes,
+           measure(options, [&] {
+               for (usize _ = 0; _ < options.iterations; ++_) {
+                   region.step(mesh);
+               }
+           }));
+
+    record("computeLaplacian", "scalar", 1, stencilBytes,
+           measure(options, [&] {
+               for (usize _ = 0; _ < options.iterations; ++_) {
+                   mesh.computeLaplacian();
+               }
+           }));
+
+    // planes written from the mapped records, named after the process so
+    // that concurrent runs keep to their own file
+    const std::string level =
+        (std::filesystem::temp_directory_path() /
+         ("HeatFlowBench-" + std::to_string(::getpid()) + ".hfl"))
+            .string();
+    if (io::writeLevel(grid, level) && io::mapLevel(level, subdivision)) {
+        record("mapLevel", "scalar", 1, 2 * sizeof(float) + sizeof(u8),
+               measure(options, [&] {
+                   for (usize _ = 0; _ < options.iterations; ++_) {
+                       if (std::optional<poss::Mesh> mapped =
+                               io::mapLevel(level, subdivision)) {
+                           mesh = std::move(*mapped);
+                       }
+                   }
+               }));
+    }
+    std::filesystem::remove(level);
+
+    const ColorMap cmap = ColorMap::Inferno();
+    std::vector<Rgba> pixels(mesh.cellCount());
+    constexpr usize pixelBytes = sizeof(float) + sizeof(u8) + sizeof(Rgba);
+    record("colormap", "scalar", 1, pixelBytes, measure(options, [&] {
+               for (usize _ = 0; _ < options.iterations; ++_) {
+                   colorize(mesh, cmap, pixels);
+               }
+           }));
+    record("colorize", "lut", 1, pixelBytes, measure(options, [&] {
+               for (usize _ = 0; _ < options.iterations; ++_) {
+                   colorizeLut(mesh, cmap, pixels);
+               }
+           }));
+}
+
+static void writeJson(std::FILE* out,
+                      const Options& options,
+                      const Stepper& stepper,
+                      const std::vector<Result>& results,
+                      const std::vector<Accuracy>& accuracy) {
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"best_kernel\": \"%s\",\n",
+                 kernel::name(kernel::detect()));
+    std::fprintf(out, "  \"stepper_threads\": %zu,\n", stepper.threadCount());
+    std::fprintf(out, "  \"warmup\": %zu,\n", options.warmup);
+    std::fprintf(out, "  \"repeats\": %zu,\n", options.repeats);
+    std::fprintf(out, "  \"results\": [\n");
+
+    for (usize i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double cellUpdates =
+            static_cast<double>(r.width * r.height) * r.iterations;
+        const double rate = cellUpdates / r.secondsMedian;
+
+        std::fprintf(out, "    {");
+        std::fprintf(out, "\"benchmark\": \"%s\", ", r.benchmark.c_str());
+        std::fprintf(out, "\"kernel\": \"%s\", ", r.kernel.c_str());
+        std::fprintf(out, "\"threads\": %zu, ", r.threads);
+        std::fprintf(out, "\"scale\": %zu, ", r.scale);
+        std::fprintf(out, "\"subdivision\": %zu, ", r.subdivision);
+        std::fprintf(out, "\"width\": %zu, ", r.width);
+        std::fprintf(out, "\"height\": %zu, ", r.height);
+        std::fprintf(out, "\"iterations\": %zu, ", r.iterations);
+        std::fprintf(out, "\"seconds_min\": %.9g, ", r.secondsMin);
+        std::fprintf(out, "\"seconds_median\": %.9g, ", r.secondsMedian);
+        std::fprintf(out, "\"cell_updates_per_second\": %.6g, ", rate);
+        std::fprintf(out, "\"bytes_per_second\": %.6g, ",
+                     rate * r.bytesPerCell);
+        std::fprintf(out, "\"ns_per_cell\": %.6g", 1e9 / rate);
+        std::fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"accuracy\": [\n");
+
+    for (usize i = 0; i < accuracy.size(); ++i) {
+        const Accuracy& a = accuracy[i];
+
+        std::fprintf(out, "    {");
+        std::fprintf(out, "\"storage\": \"%s\", ", a.storage.c_str());
+        std::fprintf(out, "\"scale\": %zu, ", a.scale);
+        std::fprintf(out, "\"subdivision\": %zu, ", a.subdivision);
+        std::fprintf(out, "\"steps\": %zu, ", a.steps);
+        std::fprintf(out, "\"max_error\": %.6g, ", a.maxError);
+        std::fprintf(out, "\"rms_error\": %.6g", a.rmsError);
+        std::fprintf(out, "}%s\n", i + 1 < accuracy.size() ? "," : "");
+    }
+
+    std::fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Stepper stepper(options.threads);
+    std::vector<Result> results;
+    std::vector<Accuracy> accuracy;
+
+    for (usize scale : options.scales) {
+        for (usize subdivision : options.subdivisions) {
+            benchMesh(options, scale, subdivision, stepper, results,
+                      accuracy);
+        }
+    }
+
+    std::FILE* out = stdout;
+    if (!options.output.empty()) {
+        out = std::fopen(options.output.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "failed to open %s\n", options.output.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    writeJson(out, options, stepper, results, accuracy);
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+}
@@ -1,367 +1,198 @@
 #include <raylib.h>
-#include <cassert>
-#include <cstdint>
-#include <numeric>
-#include <ranges>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <thread>
 #include <unordered_set>
-#include <vector>
+#include <utility>
 
 #include "ColorMap.hpp"
-#include "Rgb.hpp"
+#include "Grid.hpp"
+#include "Io.hpp"
+#include "Mesh.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "Simulation.hpp"
+#include "Stepper.hpp"
 
 static constexpr int targetFps = 60;
 
-static constexpr usize gridSize = 64;
-static constexpr usize gridWidth = 15;
-static constexpr usize gridHeight = 10;
-
-static constexpr int screenWidth = gridWidth * gridSize;
 static constexpr int scalePanelHeight = 64;
-static constexpr int screenHeight = gridHeight * gridSize + scalePanelHeight;
-
-static constexpr usize meshSubdivision = 4;
-static constexpr usize meshStep = gridSize / meshSubdivision;
-static constexpr usize meshWidth = gridWidth * meshSubdivision;
-static constexpr usize meshHeight = gridHeight * meshSubdivision;
-
-struct IntVec2 {
-    int x;
-    int y;
-};
-
-struct Look {
-    ColorMap cmap;
-    bool displayFps;
-};
-
-struct Tile {
-    enum class Kind {
-        Insulator,
-        Conductor,
-        /* Thermostat, */
-    };
 
-    /* static Tile Thermostat(u8 temp) { return {Kind::Thermostat, temp}; } */
+static constexpr usize meshSubdivision = 8;
 
-    static Tile Conductor(float temp) { return {Kind::Conductor, temp}; }
+static constexpr const char* tracePath = "HeatFlow-trace.json";
 
-    static Tile Insulator() { return {Kind::Insulator, 0}; }
+// simulated time per second when paced, the old 25 steps per 60 Hz frame
+static constexpr float simulationRate = 25 * poss::Mesh::dt * targetFps;
 
-    bool conducts() const { return kind == Kind::Conductor; }
+// largest change per step, in degrees, below which the solver idles
+static constexpr float settleTolerance = 1e-4f;
 
-    Kind kind;
-    float temperature;
-    /* uint8_t conductivity; */
-};
-
-static const char* line0 = "###############";
-static const char* line1 = "fffff#####00000";
-static const char* line2 = "fffff#####00000";
-static const char* line3 = "fffff#####00000";
-static const char* line4 = "fffff7777700000";
-static const char* line5 = "fffff7777700000";
-static const char* line6 = "fffff#####00000";
-static const char* line7 = "fffff#####00000";
-static const char* line8 = "fffff#####00000";
-static const char* line9 = "###############";
-
-static bool isHexDigit(char c) {
-    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
-}
-
-static uint8_t fromHex(char c) {
-    if (c >= '0' && c <= '9') {
-        return c - '0';
-    } else if (c >= 'a' && c <= 'f') {
-        return 10 + c - 'a';
-    } else {
-        return 0;
-    }
-}
+// cells along the side of the brush, doubled and halved by the wheel
+static constexpr usize largestBrush = 256;
 
-std::vector<Tile> parseLine(const char* s) {
-    std::vector<Tile> line;
+// degrees the arrow keys move the brush temperature by
+static constexpr float brushStep = 16.0f;
 
-    for (; *s; ++s) {
-        if (*s == '#') {
-            line.push_back(Tile::Insulator());
-        } else if (isHexDigit(*s)) {
-            line.push_back(Tile::Conductor(fromHex(*s) * 16));
-        }
+// Paints a square brush centred on each cell of the segment between two mouse
+// positions, spaced so that a fast drag leaves no gaps.
+static void stroke(Simulation& simulation,
+                   const Cursor& from,
+                   const Cursor& to) {
+    const auto distance = [](usize a, usize b) {
+        return a > b ? a - b : b - a;
+    };
+    const usize length =
+        std::max(distance(from.col, to.col), distance(from.row, to.row));
+    const usize spacing = std::max<usize>(to.size / 2, 1);
+    const usize count = length / spacing + 1;
+
+    for (usize i = 1; i <= count; ++i) {
+        const auto lerp = [&](usize a, usize b) {
+            const double t = static_cast<double>(i) / count;
+            return static_cast<usize>(a + t * (static_cast<double>(b) - a) +
+                                      0.5);
+        };
+        simulation.paint(lerp(from.col, to.col), lerp(from.row, to.row),
+                         to.size, to.size, to.brush);
     }
-
-    return line;
 }
 
-struct Grid {
-    static Grid funnel() {
-        auto t0 = parseLine(line0);
-        assert(t0.size() == gridWidth);
-        auto t1 = parseLine(line1);
-        assert(t1.size() == gridWidth);
-        auto t2 = parseLine(line2);
-        assert(t2.size() == gridWidth);
-        auto t3 = parseLine(line3);
-        assert(t3.size() == gridWidth);
-        auto t4 = parseLine(line4);
-        assert(t4.size() == gridWidth);
-        auto t5 = parseLine(line5);
-        assert(t5.size() == gridWidth);
-        auto t6 = parseLine(line6);
-        assert(t6.size() == gridWidth);
-        auto t7 = parseLine(line7);
-        assert(t7.size() == gridWidth);
-        auto t8 = parseLine(line8);
-        assert(t8.size() == gridWidth);
-        auto t9 = parseLine(line9);
-        assert(t9.size() == gridWidth);
-
-        std::vector<std::vector<Tile>> tiles{t0, t1, t2, t3, t4,
-                                             t5, t6, t7, t8, t9};
-
-        return Grid(tiles);
-    }
-
-    void drawScaleBar(const Look& look) const {
-        static constexpr int nSteps = 120;
-        static constexpr int scaleBarStep = screenWidth / nSteps;
-
-        for (int i = 0; i < nSteps; ++i) {
-            const float x = static_cast<float>(i) / (nSteps - 1);
-            DrawRectangle(i * scaleBarStep, gridHeight * gridSize, scaleBarStep,
-                          scalePanelHeight, look.cmap.get(x).opaque());
-        }
-    }
-
-    void render(const Look& look) const {
-        BeginDrawing();
-        ClearBackground(catpuccin::DarkGray.opaque());
+// space toggles the overlay, F switches between paced and flat-out stepping
+// and P writes the recorded profiler spans out as a Chrome trace.
+//
+// The left mouse button paints: 1 insulators, 2 conductors, 3 thermostats and
+// 4 only the temperature of what conducts. The wheel resizes the brush and
+// the up and down arrows change its temperature.
+static void run(poss::Mesh& mesh, Stepper& stepper, Look& look) {
+    profile::nameThread("render");
+
+    // the textures go away with `renderer`, before the window closes
+    Renderer renderer(mesh, look, scalePanelHeight);
+    Simulation simulation(
+        mesh, stepper,
+        {.rate = simulationRate, .tolerance = settleTolerance});
+
+    poss::Mesh::Brush brush = {.kind = poss::Mesh::Brush::Kind::Insulator,
+                               .temperature = 255.0f};
+    usize brushSize = 4;
+    // where the last frame painted, while the button is held
+    std::optional<Cursor> painted;
 
-        for (usize col = 0; col < gridWidth; ++col) {
-            for (usize row = 0; row < gridHeight; ++row) {
-                const Tile tile = tiles[row][col];
-
-                if (tile.kind == Tile::Kind::Insulator) {
-                    DrawRectangle(col * gridSize, row * gridSize, gridSize,
-                                  gridSize, catpuccin::DarkGray.opaque());
-                } else if (tile.kind == Tile::Kind::Conductor) {
-                    const float temp = tile.temperature / 255.0f;
-                    DrawRectangle(col * gridSize, row * gridSize, gridSize,
-                                  gridSize, look.cmap.get(temp).opaque());
-                }
-            }
-        }
-
-        if (look.displayFps) {
-            DrawFPS(0, 0);
-        }
-
-        this->drawScaleBar(look);
-
-        EndDrawing();
-    }
+    std::unordered_set<int> keys;
+    const auto pressed = [&](int key) {
+        if (IsKeyDown(key) && !keys.contains(key)) {
+            keys.insert(key);
+            return true;
+        } else if (IsKeyUp(key) && keys.contains(key)) {
+            keys.erase(key);
+        }
+        return false;
+    };
 
-    Grid(const std::vector<std::vector<Tile>>& t) : tiles(t) {
-        for (usize col = 0; col < gridWidth; ++col) {
-            std::vector<float> line(gridWidth, 0);
+    while (!WindowShouldClose()) {
+        if (pressed(KEY_SPACE)) {
+            look.displayFps = !look.displayFps;
         }
-    }
-
-    std::vector<std::vector<Tile>> tiles;
-};
-
-namespace poss {
-struct Mesh {
-    std::vector<std::vector<Tile>> tiles;
-    std::vector<std::vector<float>> laplacian;
-    usize width;
-    usize height;
-    usize tileSize;
-
-    static Mesh fromGrid(const Grid& grid, usize subdivision) {
-        const usize tileSize = gridSize / subdivision;
-        const usize width = subdivision * grid.tiles[0].size();
-        const usize height = subdivision * grid.tiles.size();
-
-        std::vector<std::vector<Tile>> tiles;
-        std::vector<std::vector<float>> laplacian;
-        tiles.reserve(height);
-        laplacian.reserve(height);
-
-        for (const auto& line : grid.tiles) {
-            std::vector<Tile> tileLine;
-            std::vector<float> laplacianLine;
-            tileLine.reserve(width);
-            laplacianLine.reserve(width);
-
-            for (const Tile& tile : line) {
-                for (usize _ = 0; _ < subdivision; ++_) {
-                    tileLine.push_back(tile);
-                    laplacianLine.push_back(0.0f);
-                }
-            }
-
-            for (usize _ = 0; _ < subdivision; ++_) {
-                tiles.push_back(tileLine);
-                laplacian.push_back(laplacianLine);
-            }
+        if (pressed(KEY_F)) {
+            simulation.setRate(simulation.rate() == 0.0f ? simulationRate
+                                                         : 0.0f);
         }
-
-        return {tiles, laplacian, width, height, tileSize};
-    }
-
-    void render(const Look& look) const {
-        BeginDrawing();
-        ClearBackground(catpuccin::DarkGray.opaque());
-
-        for (usize col = 0; col < width; ++col) {
-            for (usize row = 0; row < height; ++row) {
-                const Tile& tile = tiles[row][col];
-
-                Color color = catpuccin::DarkGray.opaque();
-                if (tile.kind == Tile::Kind::Conductor) {
-                    const float temp = tile.temperature / 255.0f;
-                    color = look.cmap.get(temp).opaque();
-                }
-                DrawRectangle(col * tileSize, row * tileSize, tileSize,
-                              tileSize, color);
+        if (pressed(KEY_P) && profile::enabled) {
+            if (profile::writeChromeTrace(tracePath)) {
+                std::printf("trace written to %s\n", tracePath);
+            } else {
+                std::fprintf(stderr, "failed to write %s\n", tracePath);
             }
         }
 
-        /*
-        for (usize col = 0; col < gridWidth; ++col) {
-            for (usize row = 0; row < gridHeight; ++row) {
-                const float l = laplacian[row][col];
-                const float scale = 1.0f;
-
-                const float x = scale * l + 0.5f;
-
-                DrawRectangle(col * gridSize, row * gridSize, gridSize,
-                              gridSize, look.cmap.get(x).opaque());
+        using Kind = poss::Mesh::Brush::Kind;
+        const std::pair<int, Kind> tools[] = {
+            {KEY_ONE, Kind::Insulator},
+            {KEY_TWO, Kind::Conductor},
+            {KEY_THREE, Kind::Thermostat},
+            {KEY_FOUR, Kind::Temperature},
+        };
+        for (const auto& [key, kind] : tools) {
+            if (pressed(key)) {
+                brush.kind = kind;
             }
         }
-                 */
-
-        if (look.displayFps) {
-            DrawFPS(0, 0);
-        }
-
-        this->drawScaleBar(look);
-
-        EndDrawing();
-    }
-
-    void drawScaleBar(const Look& look) const {
-        static constexpr int nSteps = 120;
-        static constexpr int scaleBarStep = screenWidth / nSteps;
-
-        const int heightOffset = height * tileSize;
-
-        for (int i = 0; i < nSteps; ++i) {
-            const float x = static_cast<float>(i) / (nSteps - 1);
-            DrawRectangle(i * scaleBarStep, heightOffset, scaleBarStep,
-                          scalePanelHeight, look.cmap.get(1.0f - x).opaque());
+        if (pressed(KEY_UP)) {
+            brush.temperature = std::min(brush.temperature + brushStep, 255.0f);
+        }
+        if (pressed(KEY_DOWN)) {
+            brush.temperature = std::max(brush.temperature - brushStep, 0.0f);
+        }
+        const float wheel = GetMouseWheelMove();
+        if (wheel > 0.0f) {
+            brushSize = std::min(brushSize * 2, largestBrush);
+        } else if (wheel < 0.0f) {
+            brushSize = std::max<usize>(brushSize / 2, 1);
+        }
+
+        // the field is stretched over the window above the scale bar
+        const Vector2 mouse = GetMousePosition();
+        const float cell = static_cast<float>(GetScreenWidth()) / mesh.width;
+        std::optional<Cursor> cursor;
+        if (mouse.x >= 0.0f && mouse.y >= 0.0f && mouse.x < mesh.width * cell &&
+            mouse.y < mesh.height * cell) {
+            const usize col = static_cast<usize>(mouse.x / cell);
+            const usize row = static_cast<usize>(mouse.y / cell);
+            const usize half = brushSize / 2;
+            cursor = Cursor{
+                .col = col > half ? col - half : 0,
+                .row = row > half ? row - half : 0,
+                .size = brushSize,
+                .brush = brush,
+            };
+        }
+
+        if (cursor && IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+            stroke(simulation, painted.value_or(*cursor), *cursor);
+            painted = cursor;
+        } else {
+            painted.reset();
         }
-    }
 
-    void computeLaplacian() {
-        for (usize col = 0; col < width; ++col) {
-            for (usize row = 0; row < height; ++row) {
-                laplacian[row][col] = computeLaplacianAt(col, row);
-            }
-        }
+        renderer.render(mesh, simulation.latest(), look,
+                        cursor ? &*cursor : nullptr);
     }
+}
 
-    void update() {
-        computeLaplacian();
-        constexpr float conductivity = 10.0f;
-        constexpr float dt = 0.1f;
-
-        for (usize col = 0; col < width; ++col) {
-            for (usize row = 0; row < height; ++row) {
-                Tile& tile = tiles[row][col];
-
-                if (tile.conducts()) {
-                    tile.temperature += conductivity * laplacian[row][col] * dt;
-                }
-            }
-        }
+// `HeatFlow [LEVEL]`, the funnel without a level
+int main(int argc, char** argv) {
+    std::optional<poss::Mesh> mesh;
+    if (argc < 2) {
+        mesh = poss::Mesh::fromGrid(Grid::funnel(), meshSubdivision);
+    } else if (std::string(argv[1]).ends_with(".hfl")) {
+        mesh = io::mapLevel(argv[1], meshSubdivision);
+    } else if (const std::optional<Grid> grid = io::readLevel(argv[1])) {
+        mesh = poss::Mesh::fromGrid(*grid, meshSubdivision);
     }
-
-    float computeLaplacianAt(usize col, usize row) {
-        if (!tiles[row][col].conducts()) {
-            return -1.0f;
-        }
-
-        const int col__ = static_cast<int>(col);
-        const int row__ = static_cast<int>(row);
-
-        const std::array<IntVec2, 4> neighbours{
-            IntVec2{col__, row__ + 1},
-            IntVec2{col__, row__ - 1},
-            IntVec2{col__ + 1, row__},
-            IntVec2{col__ - 1, row__},
-        };
-
-        auto isValid = [&](const IntVec2& candidate) {
-            if (candidate.x < 0 || candidate.x >= static_cast<int>(width)) {
-                return false;
-            }
-            if (candidate.y < 0 || candidate.y >= static_cast<int>(height)) {
-                return false;
-            }
-
-            return tiles[candidate.y][candidate.x].conducts();
-        };
-
-        usize count = 0;
-        float temperatureSum = 0.0f;
-        for (const auto& candidate : neighbours) {
-            if (!isValid(candidate)) {
-                continue;
-            }
-            ++count;
-            temperatureSum += tiles[candidate.y][candidate.x].temperature;
-        }
-
-        if (count == 0) {
-            return 0.0f;
-        } else {
-            return (temperatureSum / count) - tiles[row][col].temperature;
-        }
+    if (!mesh) {
+        std::fprintf(stderr, "failed to load %s\n", argv[1]);
+        return EXIT_FAILURE;
     }
-};
-}  // namespace poss
 
-int main() {
+    const int screenWidth = static_cast<int>(mesh->width * mesh->tileSize);
+    const int screenHeight =
+        static_cast<int>(mesh->height * mesh->tileSize) + scalePanelHeight;
     InitWindow(screenWidth, screenHeight, "hi");
     SetTargetFPS(targetFps);
 
-    Grid grid = Grid::funnel();
-    poss::Mesh mesh = poss::Mesh::fromGrid(grid, 8);
+    // one hardware thread is left to the render loop
+    const usize threads = std::thread::hardware_concurrency();
+    Stepper stepper(threads > 1 ? threads - 1 : 1);
     Look look = {
         .cmap = ColorMap::Inferno(),
         .displayFps = true,
     };
 
-    std::unordered_set<int> keys;
-
-    while (!WindowShouldClose()) {
-        constexpr int space = KEY_SPACE;
-        if (IsKeyDown(space) && !keys.contains(space)) {
-            look.displayFps = !look.displayFps;
-            keys.insert(space);
-        } else if (IsKeyUp(KEY_SPACE) && keys.contains(space)) {
-            keys.erase(space);
-        }
-
-        constexpr usize updatesPerFrame = 25;
-        for (usize _ = 0; _ < updatesPerFrame; _++) {
-            mesh.update();
-        }
-
-        mesh.render(look);
-    }
+    run(*mesh, stepper, look);
 
     CloseWindow();
 }
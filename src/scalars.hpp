@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+
+#include "ints.hpp"
+
+// Storage formats for temperature planes. Each `Storage<T>` converts between
+// the stored `T` and the `Accum` type arithmetic is done in, which is float
+// for everything but double.
+
+// IEEE 754 binary16, converted in software
+struct Half {
+    u16 bits;
+};
+
+// the upper half of a float
+struct BFloat16 {
+    u16 bits;
+};
+
+// unsigned 8.8 fixed point, which covers the [0, 255] display range with a
+// 1/256 step
+struct Fixed16 {
+    u16 bits;
+};
+
+template <typename T>
+struct Storage;
+
+template <>
+struct Storage<float> {
+    using Accum = float;
+    static constexpr const char* name = "float";
+
+    static float load(float v) { return v; }
+    static float store(float v) { return v; }
+};
+
+template <>
+struct Storage<double> {
+    using Accum = double;
+    static constexpr const char* name = "double";
+
+    static double load(double v) { return v; }
+    static double store(double v) { return v; }
+};
+
+template <>
+struct Storage<Half> {
+    using Accum = float;
+    static constexpr const char* name = "half";
+
+    static float load(Half h) {
+        constexpr u32 shiftedExponent = 0x7c00u << 13;
+        constexpr u32 magic = 113u << 23;
+
+        u32 o = (h.bits & 0x7fffu) << 13;
+        const u32 exponent = o & shiftedExponent;
+        o += (127 - 15) << 23;
+        if (exponent == shiftedExponent) {
+            // infinity and NaN
+            o += (128 - 16) << 23;
+        } else if (exponent == 0) {
+            // subnormal, renormalised by the FPU
+            o += 1 << 23;
+            o = std::bit_cast<u32>(std::bit_cast<float>(o) -
+                                   std::bit_cast<float>(magic));
+        }
+        return std::bit_cast<float>(o | (h.bits & 0x8000u) << 16);
+    }
+
+    // rounds to nearest even
+    static Half store(float v) {
+        constexpr u32 infinity = 255u << 23;
+        constexpr u32 overflow = (127u + 16) << 23;
+        constexpr u32 subnormal = 113u << 23;
+        constexpr u32 denormalMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+        u32 bits = std::bit_cast<u32>(v);
+        const u32 sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        u32 o;
+        if (bits >= overflow) {
+            o = bits > infinity ? 0x7e00u : 0x7c00u;
+        } else if (bits < subnormal) {
+            const float shifted = std::bit_cast<float>(bits) +
+                                  std::bit_cast<float>(denormalMagic);
+            o = std::bit_cast<u32>(shifted) - denormalMagic;
+        } else {
+            const u32 odd = (bits >> 13) & 1;
+            bits += ((15u - 127) << 23) + 0xfffu + odd;
+            o = bits >> 13;
+        }
+        return {static_cast<u16>(o | sign >> 16)};
+    }
+};
+
+template <>
+struct Storage<BFloat16> {
+    using Accum = float;
+    static constexpr const char* name = "bf16";
+
+    static float load(BFloat16 b) {
+        return std::bit_cast<float>(static_cast<u32>(b.bits) << 16);
+    }
+
+    // rounds to nearest even, temperatures are never NaN
+    static BFloat16 store(float v) {
+        const u32 bits = std::bit_cast<u32>(v);
+        return {static_cast<u16>((bits + 0x7fffu + ((bits >> 16) & 1)) >> 16)};
+    }
+};
+
+template <>
+struct Storage<Fixed16> {
+    using Accum = float;
+    static constexpr const char* name = "u16";
+
+    static float load(Fixed16 f) { return f.bits * (1.0f / 256.0f); }
+
+    // rounds to nearest even by pushing the fraction out of the mantissa,
+    // which unlike `nearbyint` vectorises; ties are common, as neighbour
+    // averages land on half steps
+    static Fixed16 store(float v) {
+        constexpr float round = 8388608.0f;
+        const float scaled = std::clamp(v * 256.0f, 0.0f, 65535.0f);
+        return {static_cast<u16>((scaled + round) - round)};
+    }
+};
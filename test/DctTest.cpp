@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "Dct.hpp"
+
+static std::vector<double> sequence(usize n, double phase) {
+    std::vector<double> x(n);
+    for (usize i = 0; i < n; ++i) {
+        x[i] = std::sin(phase * (i + 1)) * 100.0 + static_cast<double>(i % 7);
+    }
+    return x;
+}
+
+// the round trip is exact up to the rounding of the FFT, on values of about
+// a hundred
+static constexpr double tolerance = 1e-10;
+
+// lengths along each radix of the FFT, and a prime that takes the generic
+// butterfly on its own
+TEST(Dct, InverseUndoesForward) {
+    for (usize n : {1, 2, 3, 4, 5, 8, 12, 30, 64, 97, 120, 256}) {
+        SCOPED_TRACE(n);
+        Dct dct(n);
+        const std::vector<double> original = sequence(n, 0.7);
+        std::vector<double> x = original;
+        dct.forward(x.data());
+        dct.inverse(x.data());
+        for (usize i = 0; i < n; ++i) {
+            EXPECT_NEAR(x[i], original[i], tolerance);
+        }
+    }
+}
+
+TEST(Dct, PairsMatchSingles) {
+    for (usize n : {6, 64, 97}) {
+        SCOPED_TRACE(n);
+        Dct dct(n);
+        std::vector<double> x = sequence(n, 0.3);
+        std::vector<double> y = sequence(n, 1.9);
+        std::vector<double> singleX = x;
+        std::vector<double> singleY = y;
+
+        dct.forward(x.data(), y.data());
+        dct.forward(singleX.data());
+        dct.forward(singleY.data());
+        for (usize i = 0; i < n; ++i) {
+            EXPECT_NEAR(x[i], singleX[i], tolerance * n);
+            EXPECT_NEAR(y[i], singleY[i], tolerance * n);
+        }
+
+        dct.inverse(x.data(), y.data());
+        const std::vector<double> originalX = sequence(n, 0.3);
+        const std::vector<double> originalY = sequence(n, 1.9);
+        for (usize i = 0; i < n; ++i) {
+            EXPECT_NEAR(x[i], originalX[i], tolerance);
+            EXPECT_NEAR(y[i], originalY[i], tolerance);
+        }
+    }
+}
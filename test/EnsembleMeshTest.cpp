@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "EnsembleMesh.hpp"
+#include "Kernel.hpp"
+#include "fields.hpp"
+
+static constexpr usize steps = 101;
+
+// `Mesh::update` with other parameters, through the scalar kernel
+static void update(poss::Mesh& mesh, const EnsembleMesh::Member& member) {
+    for (usize _ = 0; _ < steps; ++_) {
+        kernel::Step args = mesh.stepArgs();
+        args.conductivity = member.conductivity;
+        args.dt = member.dt;
+        kernel::get(kernel::Isa::Scalar)(args, mesh.stride,
+                                         (mesh.height + 1) * mesh.stride);
+        mesh.pins().apply(mesh.scratch.data(), 0, mesh.scratch.size());
+        std::swap(mesh.temperature, mesh.scratch);
+    }
+}
+
+TEST(EnsembleMesh, MembersMatchUpdate) {
+    const poss::Mesh start = testMesh();
+
+    // enough members to take more than one vector whatever the kernel
+    std::vector<EnsembleMesh::Member> members;
+    for (usize m = 0; m < 19; ++m) {
+        members.push_back({
+            .conductivity = poss::Mesh::conductivity * (m + 1) / 19,
+            .dt = m % 2 == 0 ? poss::Mesh::dt : poss::Mesh::dt / 2,
+        });
+    }
+    EnsembleMesh ensemble(start, members);
+    ensemble.update(steps);
+
+    for (usize m = 0; m < members.size(); ++m) {
+        SCOPED_TRACE(m);
+        poss::Mesh expected = start;
+        update(expected, members[m]);
+
+        poss::Mesh mesh = start;
+        ensemble.extract(m, mesh);
+        EXPECT_TRUE(sameField(mesh, expected));
+    }
+}
+
+TEST(EnsembleMesh, DefaultMemberMatchesMeshUpdate) {
+    const poss::Mesh start = testMesh();
+    const std::vector<EnsembleMesh::Member> members(2);
+    EnsembleMesh ensemble(start, members);
+    ensemble.update(steps);
+
+    poss::Mesh expected = start;
+    for (usize _ = 0; _ < steps; ++_) {
+        expected.update();
+    }
+    poss::Mesh mesh = start;
+    ensemble.extract(1, mesh);
+    EXPECT_TRUE(sameField(mesh, expected));
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "Kernel.hpp"
+#include "fields.hpp"
+
+// every variant writes the scalar kernel's values, bit for bit
+TEST(Kernel, EveryIsaMatchesScalar) {
+    poss::Mesh mesh = testMesh();
+    const usize begin = mesh.stride;
+    const usize end = (mesh.height + 1) * mesh.stride;
+
+    AlignedVector<float> expected(mesh.scratch.size(), 0.0f);
+    kernel::Step args = mesh.stepArgs();
+    args.dst = expected.data();
+    kernel::get(kernel::Isa::Scalar)(args, begin, end);
+
+    for (kernel::Isa isa : {kernel::Isa::Scalar, kernel::Isa::Sse41,
+                            kernel::Isa::Avx2, kernel::Isa::Avx512}) {
+        if (!kernel::supported(isa)) {
+            continue;
+        }
+        SCOPED_TRACE(kernel::name(isa));
+
+        AlignedVector<float> stepped(mesh.scratch.size(), 0.0f);
+        args.dst = stepped.data();
+        kernel::get(isa)(args, begin, end);
+        EXPECT_EQ(std::memcmp(stepped.data(), expected.data(),
+                              expected.size() * sizeof(float)),
+                  0);
+
+        AlignedVector<float> monitored(mesh.scratch.size(), 0.0f);
+        args.dst = monitored.data();
+        kernel::getMonitor(isa)(args, begin, end);
+        EXPECT_EQ(std::memcmp(monitored.data(), expected.data(),
+                              expected.size() * sizeof(float)),
+                  0);
+    }
+}
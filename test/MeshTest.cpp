@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "ActiveRegion.hpp"
+#include "Stepper.hpp"
+#include "fields.hpp"
+
+static constexpr usize steps = 101;
+
+static poss::Mesh updated(poss::Mesh mesh) {
+    for (usize _ = 0; _ < steps; ++_) {
+        mesh.update();
+    }
+    return mesh;
+}
+
+TEST(Mesh, StepperMatchesUpdate) {
+    const poss::Mesh start = testMesh();
+    const poss::Mesh expected = updated(start);
+
+    for (usize threads : {1, 2, 3, 4}) {
+        SCOPED_TRACE(threads);
+        poss::Mesh mesh = start;
+        Stepper stepper(threads);
+        mesh.update(stepper, steps);
+        EXPECT_TRUE(sameField(mesh, expected));
+    }
+}
+
+TEST(Mesh, AdvanceMatchesUpdate) {
+    const poss::Mesh start = testMesh();
+    const poss::Mesh expected = updated(start);
+
+    poss::Mesh mesh = start;
+    mesh.advance(steps);
+    EXPECT_TRUE(sameField(mesh, expected));
+}
+
+TEST(ActiveRegion, ZeroThresholdMatchesUpdate) {
+    const poss::Mesh start = testMesh();
+    const poss::Mesh expected = updated(start);
+
+    poss::Mesh mesh = start;
+    ActiveRegion region(mesh, {.blockSize = 8, .threshold = 0.0f});
+    for (usize _ = 0; _ < steps; ++_) {
+        region.step(mesh);
+    }
+    EXPECT_TRUE(sameField(mesh, expected));
+}
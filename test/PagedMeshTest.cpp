@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "PagedMesh.hpp"
+#include "fields.hpp"
+
+static constexpr usize subdivision = 4;
+static constexpr usize steps = 101;
+
+static std::string pagedPath() {
+    return (std::filesystem::temp_directory_path() /
+            ("HeatFlowTest-" + std::to_string(::getpid()) + ".paged"))
+        .string();
+}
+
+// the depth and bands are forced small, so the run takes several sweeps and
+// evicts as it goes
+TEST(PagedMesh, MatchesAdvance) {
+    const Grid grid = Grid::funnel();
+    poss::Mesh expected = poss::Mesh::fromGrid(grid, subdivision);
+    expected.advance(steps);
+
+    PagedMesh mesh(grid, subdivision, pagedPath(),
+                   {.resident = 16 * 1024, .bandRows = 4, .maxDepth = 8});
+    ASSERT_TRUE(mesh.ok());
+    EXPECT_TRUE(mesh.paging());
+    mesh.advance(steps);
+    EXPECT_GT(mesh.stats().sweeps, 1u);
+
+    ASSERT_EQ(mesh.width(), expected.width);
+    ASSERT_EQ(mesh.height(), expected.height);
+    for (usize row = 0; row < expected.height; ++row) {
+        SCOPED_TRACE(row);
+        EXPECT_EQ(std::memcmp(mesh.row(row),
+                              &expected.temperature[expected.index(0, row)],
+                              expected.width * sizeof(float)),
+                  0);
+    }
+}
+
+TEST(PagedMesh, RefusesAnExistingFile) {
+    const std::string path = pagedPath();
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    std::fclose(file);
+
+    const PagedMesh mesh(Grid::funnel(), subdivision, path, {});
+    EXPECT_FALSE(mesh.ok());
+    EXPECT_TRUE(std::filesystem::exists(path));
+    std::filesystem::remove(path);
+}
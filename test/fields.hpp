@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstring>
+
+#include "Grid.hpp"
+#include "Mesh.hpp"
+#include "ints.hpp"
+
+// the funnel at a small subdivision, stepped a little so the field is no
+// longer made of a few flat values
+inline poss::Mesh testMesh(usize subdivision = 4) {
+    poss::Mesh mesh = poss::Mesh::fromGrid(Grid::funnel(), subdivision);
+    for (usize _ = 0; _ < 20; ++_) {
+        mesh.update();
+    }
+    return mesh;
+}
+
+// whether the temperature planes hold the same bits, halo included
+inline bool sameField(const poss::Mesh& a, const poss::Mesh& b) {
+    return a.temperature.size() == b.temperature.size() &&
+           std::memcmp(a.temperature.data(), b.temperature.data(),
+                       a.temperature.size() * sizeof(float)) == 0;
+}